@@ -38,6 +38,9 @@
 #include 			 "moreGlobals.h"
 #include			 "fileSystem.h"
 #include			 "memoryManager.h"
+#include			 "schedTrace.h"
+#include			 "interlockManager.h"
+#include			 "volumeManager.h"
 
 
 //  This is a mapping of system call nmemonics with definitions
@@ -47,7 +50,8 @@ char *call_names[] = {"MemRead  ", "MemWrite ", "ReadMod  ", "GetTime  ",
         "Resume   ", "ChPrior  ", "Send     ", "Receive  ", "PhyDskRd ",
         "PhyDskWrt", "DefShArea", "Format   ", "CheckDisk", "OpenDir  ",
         "OpenFile ", "CreaDir  ", "CreaFile ", "ReadFile ", "WriteFile",
-        "CloseFile", "DirContnt", "DelDirect", "DelFile  " };
+        "CloseFile", "DirContnt", "DelDirect", "DelFile  ", "SetDeadln",
+        "Sync     " };
 
 
 /************************************************************************
@@ -89,31 +93,14 @@ void InterruptHandler(void) {
 
     	if(DeviceID == TIMER_INTERRUPT) {
     		interruptPrint("InterruptHandler: Timer interrupt found.\n");
-    		timerLock();
-    		TimerRequest* req = (TimerRequest*)QRemoveHead(timerQueueID);
-    		timerUnlock();
-
-    		if((int)req == -1) {
-    			return;
-    		}
-
-    		if(interruptPrints < INTERRUPT_PRINTS_LIMIT) {
-
-    			aprintf("InterruptHandler: Process gotten from timer queue, PID %d\n", req->process->pid);
-
-    		}
-
-    		//this timer request has been fulfilled.
-    		//make its process ready.
-    		addToReadyQueue(req->process);
-
     		timerLock();
     		TimerRequest* next = (TimerRequest*)QNextItemInfo(timerQueueID);
     		timerUnlock();
 
-    		//we now manage the other requests in the queue.
-    		//ones that have already ocurred go in the ready queue.
+    		//requests that have already ocurred go in the ready queue.
     		//when we find one that hasn't, start the timer and then stop.
+    		//even the head may not be due yet, if the process the timer
+    		//was started for has since been terminated.
     		while((int)next != -1) {
 
     			//already occurred. put it in ready queue.
@@ -123,15 +110,20 @@ void InterruptHandler(void) {
     				QRemoveHead(timerQueueID);
     				timerUnlock();
 
-    				readyLock();
-    				addToReadyQueue(next->process);
-    				readyUnlock();
+    				//a process terminated while it ran on another
+    				//processor may still have gone to sleep. it stays asleep.
+    				if(getProcess(next->process->pid) == next->process) {
 
-    				if(interruptPrints < INTERRUPT_PRINTS_LIMIT) {
+    					traceInterruptEvent(TRACE_WAKE, next->process, TRACE_REASON_SLEEP);
+    					addToReadyQueue(next->process);
 
-						aprintf("InterruptHandler: Process gotten from timer queue, PID %d\n", next->process->pid);
+    					if(interruptPrints < INTERRUPT_PRINTS_LIMIT) {
 
-					}
+    						aprintf("InterruptHandler: Process gotten from timer queue, PID %d\n", next->process->pid);
+
+    					}
+
+    				}
 
     				timerLock();
     				next = (TimerRequest*)QNextItemInfo(timerQueueID);
@@ -168,16 +160,16 @@ void InterruptHandler(void) {
     		int diskID = DeviceID - 5;
 
     		diskLock();
-    		//aprintf("Disk interrupt starting.\n");
 
-    		//get the 1st currently using one.
-    		Process* proc = removeFromDiskQueue(diskID, 0);
+    		//wake the process whose request finished.
+    		//the disk has already been given the next one.
+    		Process* proc = finishDiskRequest(diskID, mmio.Field3, Status);
 
-    		//get the other ones, ignoring ones currently using disk.
-    		while((int)proc != -1) {
-    			//aprintf("INTERRUPT: Making process %d ready.\n", proc->pid);
-    			addToReadyQueue(proc);
-    			proc = removeFromDiskQueue(diskID, 1);
+    		//a terminated process gives up its request, but check
+    		//it's still alive anyway, as the timer does.
+    		if((int)proc != -1 && getProcess(proc->pid) == proc) {
+    			traceInterruptEvent(TRACE_WAKE, proc, TRACE_REASON_DISK);
+    			wakeProcess(proc);
     		}
     		diskUnlock();
 
@@ -209,7 +201,11 @@ void InterruptHandler(void) {
 
     			}
 
-    			exit(0);
+    			//reading a sector nobody wrote leaves the reader's
+    			//buffer as it was. anything else is an OS bug.
+    			if(Status != ERR_NO_PREVIOUS_WRITE) {
+    				exit(0);
+    			}
 
     		} else {
     			interruptPrint("Interrupt Handler: Disk interrupt found\n");
@@ -302,6 +298,24 @@ void svc(SYSTEM_CALL_DATA *SystemCallData) {
         }
         do_print--;
     }
+
+    if(SystemCallData->SystemCallNumber != SYSNUM_MULTIDISPATCH) {
+
+    	Process* current = currentProcess();
+
+    	//a process terminated while it ran on another processor ends here.
+    	if(current->terminatePending) {
+    		terminateProcess(-1);
+    		return;
+    	}
+
+    	//a real-time process can only be held to its budget here,
+    	//and a normal one to its fair share.
+    	enforceEdfBudget(current);
+    	enforceFairShare(current);
+
+    }
+
     switch(SystemCallData->SystemCallNumber) {
     	case SYSNUM_TERMINATE_PROCESS: {
     		long pid = (long)SystemCallData->Argument[0];
@@ -350,6 +364,10 @@ void svc(SYSTEM_CALL_DATA *SystemCallData) {
     	case SYSNUM_SLEEP: {
 
     		long time = (long)SystemCallData->Argument[0];
+
+    		//a real-time process sleeps when its job is done.
+    		completeEdfJob(currentProcess());
+
     		startTimer(time);
     		//idle();
     		dispatch();
@@ -386,9 +404,18 @@ void svc(SYSTEM_CALL_DATA *SystemCallData) {
     		char* processName = (char*)SystemCallData->Argument[0];
     		void* startingAddress = (void*)SystemCallData->Argument[1];
     		long initialPriority = (long)SystemCallData->Argument[2];
+    		long groupId = 0;
     		long* pid = (long*)SystemCallData->Argument[3];
     		long* errorReturned = (long*)SystemCallData->Argument[4];
-    		int result = createProcess(processName,startingAddress,initialPriority,pid);
+
+    		//CREATE_PROCESS_IN_GROUP has the group id before the returns.
+    		if(SystemCallData->NumberOfArguments > 6) {
+    			groupId = (long)SystemCallData->Argument[3];
+    			pid = (long*)SystemCallData->Argument[4];
+    			errorReturned = (long*)SystemCallData->Argument[5];
+    		}
+
+    		int result = createProcess(processName,startingAddress,initialPriority,groupId,pid);
 
     		//if we ran successfully, make errorReturned = ERR_SUCCESS.
     		if(result != -1) {
@@ -452,6 +479,37 @@ void svc(SYSTEM_CALL_DATA *SystemCallData) {
 
     	}
 
+    	case SYSNUM_READ_MODIFY: {
+
+    		long address = (long)SystemCallData->Argument[0];
+    		long newValue = (long)SystemCallData->Argument[1];
+    		long suspend = (long)SystemCallData->Argument[2];
+    		INT32* successfulAction = (INT32*)SystemCallData->Argument[3];
+
+    		*successfulAction = readModify(address, newValue, suspend);
+
+    		break;
+    	}
+
+    	case SYSNUM_SET_DEADLINE: {
+
+    		long pid = (long)SystemCallData->Argument[0];
+    		long period = (long)SystemCallData->Argument[1];
+    		long relativeDeadline = (long)SystemCallData->Argument[2];
+    		long budget = (long)SystemCallData->Argument[3];
+    		long* errorReturned = (long*)SystemCallData->Argument[4];
+
+    		long result = setDeadline(pid, period, relativeDeadline, budget);
+
+    		if(result == 0) {
+				*errorReturned = ERR_SUCCESS;
+			} else {
+				*errorReturned = result;
+			}
+
+    		break;
+    	}
+
     	case SYSNUM_SEND_MESSAGE: {
 
     		long targetPID = (long)SystemCallData->Argument[0];
@@ -610,6 +668,21 @@ void svc(SYSTEM_CALL_DATA *SystemCallData) {
     		break;
     	}
 
+    	case SYSNUM_SYNC: {
+
+    		long* errorReturned = (long*)SystemCallData->Argument[0];
+
+    		int result = syncFileSystem();
+
+    		if(result == 0) {
+    			*errorReturned = ERR_SUCCESS;
+    		} else {
+    			*errorReturned = result;
+    		}
+
+    		break;
+    	}
+
     	case SYSNUM_READ_FILE: {
 
     		long inode = (int)SystemCallData->Argument[0];
@@ -653,12 +726,151 @@ void svc(SYSTEM_CALL_DATA *SystemCallData) {
  defined and initialized here.
  ************************************************************************/
 
+/**
+ * Reads the boot options given on the command line.
+ * Options come after the test name and look like key=value.
+ * Options:
+ * sched=priority|fair: the policy for ordering normal processes.
+ * boost=N: the wakeup boost, in levels, for normal processes, 0 to MAX_WAKEUP_BOOST.
+ * EDF processes take no boost, since they're ordered by deadline, not priority.
+ * trace or trace=file: record scheduling events to a file.
+ * disk=clook|sstf|fifo: the order disks serve waiting requests in.
+ * diskmodel=linear|rotational|flash: how long the disks take to serve requests.
+ * stripe=N: FORMAT spreads file data over N disks, 1 to MAX_NUMBER_OF_DISKS.
+ * mirror: FORMAT copies file data onto the next disk as well.
+ * cpus=N: how many processors multiprocessor mode runs with, 1 to MAX_NUMBER_OF_PROCESSORS.
+ * Parameters:
+ * argc, argv: the command line given to osInit.
+ */
+void parseBootOptions(int argc, char *argv[]) {
+
+	schedulingPolicy = SCHED_POLICY_PRIORITY;
+	wakeupBoost[SCHED_CLASS_NORMAL] = DEFAULT_WAKEUP_BOOST;
+	wakeupBoost[SCHED_CLASS_EDF] = 0; //EDF processes run by deadline, not priority.
+	diskSchedulingPolicy = DISK_SCHED_CLOOK;
+	setDiskTimingModel(DISK_TIMING_LINEAR);
+	stripeWidth = 1;
+	mirrorVolumes = 0;
+	bootProcessors = MAX_NUMBER_OF_PROCESSORS;
+
+	for(int i = 2; i < argc; i++) {
+
+		char* value = strchr(argv[i], '=');
+
+		if(strcmp(argv[i], "trace") == 0) {
+			initTrace(TRACE_DEFAULT_FILE);
+			continue;
+		}
+
+		if(strcmp(argv[i], "mirror") == 0) {
+			mirrorVolumes = 1;
+			continue;
+		}
+
+		//not an option. probably the M flag.
+		if(value == NULL) {
+			continue;
+		}
+
+		++value;
+
+		if(strncmp(argv[i], "sched=", 6) == 0) {
+
+			if(strcmp(value, "fair") == 0) {
+				schedulingPolicy = SCHED_POLICY_FAIR;
+				aprintf("Scheduling policy: fair share\n");
+			} else if(strcmp(value, "priority") == 0) {
+				schedulingPolicy = SCHED_POLICY_PRIORITY;
+			} else {
+				aprintf("Unknown scheduling policy %s. Using priority.\n", value);
+			}
+
+		} else if(strncmp(argv[i], "trace=", 6) == 0) {
+
+			initTrace(value);
+
+		} else if(strncmp(argv[i], "boost=", 6) == 0) {
+
+			char* end;
+			long boost = strtol(value, &end, 10);
+
+			if(end == value || *end != '\0' || boost < 0 || boost > MAX_WAKEUP_BOOST) {
+				aprintf("Bad wakeup boost %s. It must be 0 to %d. Using %d.\n",
+						value, MAX_WAKEUP_BOOST, DEFAULT_WAKEUP_BOOST);
+			} else {
+				wakeupBoost[SCHED_CLASS_NORMAL] = boost;
+				aprintf("Wakeup boost: %ld\n", boost);
+			}
+
+		} else if(strncmp(argv[i], "disk=", 5) == 0) {
+
+			if(strcmp(value, "sstf") == 0) {
+				diskSchedulingPolicy = DISK_SCHED_SSTF;
+				aprintf("Disk scheduling: shortest seek first\n");
+			} else if(strcmp(value, "fifo") == 0) {
+				diskSchedulingPolicy = DISK_SCHED_FIFO;
+				aprintf("Disk scheduling: arrival order\n");
+			} else if(strcmp(value, "clook") == 0) {
+				diskSchedulingPolicy = DISK_SCHED_CLOOK;
+			} else {
+				aprintf("Unknown disk scheduling policy %s. Using clook.\n", value);
+			}
+
+		} else if(strncmp(argv[i], "diskmodel=", 10) == 0) {
+
+			if(strcmp(value, "rotational") == 0) {
+				setDiskTimingModel(DISK_TIMING_ROTATIONAL);
+				aprintf("Disk timing: seek and rotation\n");
+			} else if(strcmp(value, "flash") == 0) {
+				setDiskTimingModel(DISK_TIMING_FLASH);
+				aprintf("Disk timing: flash\n");
+			} else if(strcmp(value, "linear") == 0) {
+				setDiskTimingModel(DISK_TIMING_LINEAR);
+			} else {
+				aprintf("Unknown disk timing model %s. Using linear.\n", value);
+			}
+
+		} else if(strncmp(argv[i], "stripe=", 7) == 0) {
+
+			char* end;
+			long width = strtol(value, &end, 10);
+
+			if(end == value || *end != '\0' || width < 1 || width > MAX_NUMBER_OF_DISKS) {
+				aprintf("Bad stripe width %s. It must be 1 to %d. Not striping.\n",
+						value, MAX_NUMBER_OF_DISKS);
+			} else {
+				stripeWidth = width;
+				aprintf("Stripe width: %ld\n", width);
+			}
+
+		} else if(strncmp(argv[i], "cpus=", 5) == 0) {
+
+			char* end;
+			long cpus = strtol(value, &end, 10);
+
+			if(end == value || *end != '\0' || cpus < 1 || cpus > MAX_NUMBER_OF_PROCESSORS) {
+				aprintf("Bad processor count %s. It must be 1 to %d. Using %d.\n",
+						value, MAX_NUMBER_OF_PROCESSORS, MAX_NUMBER_OF_PROCESSORS);
+			} else {
+				bootProcessors = cpus;
+				aprintf("Processors: %ld\n", cpus);
+			}
+
+		} else {
+			aprintf("Unknown boot option %s\n", argv[i]);
+		}
+
+	}
+
+}
+
 void osInit(int argc, char *argv[]) {
     // Every process will have a page table.  This will be used in
     // the second half of the project.  
     void *PageTable = (void *) calloc(2, NUMBER_VIRTUAL_PAGES);
     INT32 i;
     MEMORY_MAPPED_IO mmio;
+    int multiprocessor = FALSE;
 
     // Demonstrates how calling arguments are passed thru to here
 
@@ -671,6 +883,9 @@ void osInit(int argc, char *argv[]) {
     // Here we check if a second argument is present on the command line.
     // If so, run in multiprocessor mode.  Note - sometimes people change
     // around where the "M" should go.  Allow for both possibilities
+    //the boot options come first, since they say how many processors to ask for.
+    parseBootOptions(argc, argv);
+
     if (argc > 2) {
         if ((strcmp(argv[1], "M") ==0) || (strcmp(argv[1], "m")==0)) {
             strcpy(argv[1], argv[2]);
@@ -678,14 +893,17 @@ void osInit(int argc, char *argv[]) {
         }
         if ((strcmp(argv[2], "M") ==0) || (strcmp(argv[2], "m")==0)) {
             aprintf("Simulation is running as a MultProcessor\n\n");
+            multiprocessor = TRUE;
             mmio.Mode = Z502SetProcessorNumber;
-            mmio.Field1 = MAX_NUMBER_OF_PROCESSORS;
+            mmio.Field1 = bootProcessors;
             mmio.Field2 = (long) 0;
             mmio.Field3 = (long) 0;
             mmio.Field4 = (long) 0;
             MEM_WRITE(Z502Processor, &mmio);   // Set the number of processors
         }
-    } else {
+    }
+
+    if (!multiprocessor) {
         aprintf("Simulation is running as a UniProcessor\n");
         aprintf("Add an 'M' to the command line to invoke multiprocessor operation.\n\n");
     }
@@ -870,6 +1088,66 @@ void osInit(int argc, char *argv[]) {
     	long address = (long)test46;
     	pcbInit(address, (long)PageTable);
 
+    } else if((argc > 1) && (strcmp(argv[1], "test50") == 0)) {
+
+    	long address = (long)test50;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test51") == 0)) {
+
+    	long address = (long)test51;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test52") == 0)) {
+
+    	long address = (long)test52;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test53") == 0)) {
+
+    	long address = (long)test53;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test54") == 0)) {
+
+    	long address = (long)test54;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test55") == 0)) {
+
+    	long address = (long)test55;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test56") == 0)) {
+
+    	long address = (long)test56;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test57") == 0)) {
+
+    	long address = (long)test57;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test58") == 0)) {
+
+    	long address = (long)test58;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test59") == 0)) {
+
+    	long address = (long)test59;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test60") == 0)) {
+
+    	long address = (long)test60;
+    	pcbInit(address, (long)PageTable);
+
+    } else if((argc > 1) && (strcmp(argv[1], "test61") == 0)) {
+
+    	long address = (long)test61;
+    	pcbInit(address, (long)PageTable);
+
     }
 
     //otherwise, we do the default: running test0.
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <limits.h>
 #include "global.h"
 #include "syscalls.h"
 #include "protos.h"
@@ -16,225 +17,890 @@
 #include "processManager.h"
 #include "dispatcher.h"
 #include "fileSystem.h"
+#include "schedTrace.h"
+
+long diskSequence = 0; //the sequence number of the latest request.
+
+//for each sector, the earliest sequence of a queued request, and of
+//a queued write, touching it. filled in by scanDiskQueue for one disk.
+long firstQueuedAt[NUMBER_LOGICAL_SECTORS];
+long firstWriteAt[NUMBER_LOGICAL_SECTORS];
 
 /**
- * Initializes the disk manager by creating the disk queue.
+ * Adds a value to a histogram.
+ * Parameters:
+ * histogram: the histogram to add to.
+ * value: the value. Negative values count as 0.
+ */
+void recordHistogram(DiskHistogram* histogram, long value) {
+
+	if(value < 0) {
+		value = 0;
+	}
+
+	int bucket = 0;
+
+	while(bucket < DISK_HISTOGRAM_BUCKETS - 1 && value >= (1L << bucket)) {
+		++bucket;
+	}
+
+	++histogram->counts[bucket];
+	++histogram->samples;
+	histogram->total += value;
+
+	if(value > histogram->max) {
+		histogram->max = value;
+	}
+
+}
+
+/**
+ * Changes how many requests a disk has outstanding,
+ * keeping track of the average over time.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * diskID: the disk.
+ * change: how much to add to the count.
+ */
+void changeOutstanding(long diskID, int change) {
+
+	DiskStats* stats = &diskStats[diskID];
+	long now = getTimeOfDay();
+
+	stats->depthArea += stats->outstanding * (now - stats->lastDepthChange);
+	stats->lastDepthChange = now;
+	stats->outstanding += change;
+
+}
+
+/**
+ * Initializes the disk manager by creating
+ * a queue for each disk.
  */
 void initDiskManager() {
 
-	diskQueueId = QCreate("diskQueue");
+	char name[16];
+
+	for(int i = 0; i < MAX_NUMBER_OF_DISKS; i++) {
+		sprintf(name, "diskQ%d", i);
+		diskQueueIds[i] = QCreate(name);
+		diskQueued[i] = NULL;
+		diskQueuedCounts[i] = 0;
+		diskQueuedRoom[i] = 0;
+		diskInFlightCounts[i] = 0;
+		diskHeads[i] = 0;
+		memset(&diskStats[i], 0, sizeof(DiskStats));
+
+		MEMORY_MAPPED_IO mmio;
+		mmio.Mode = Z502DiskSetTiming;
+		mmio.Field1 = i;
+		mmio.Field2 = 0;
+		mmio.Field3 = (long)&diskTiming;
+		mmio.Field4 = 0;
+
+		MEM_WRITE(Z502Disk, &mmio);
+
+		if(mmio.Field4 != ERR_SUCCESS) {
+			aprintf("Disk %d refused timing model %ld\n", i, diskTiming.Model);
+		}
+	}
 
 }
 
 /**
- * This adds the currently running process to
- * the disk queue, requesting the given diskID
+ * Chooses the timing model the disks are given
+ * when the disk manager starts, with its default parameters.
  * Parameters:
- * diskID: the diskID requested by the currently running process.
- * currentlyUsing: whether the process is currently using disk.
+ * model: one of the DISK_TIMING_ models.
  */
-void addToDiskQueue(long diskID, int currentlyUsing) {
+void setDiskTimingModel(int model) {
 
-	DiskRequest* req = malloc(sizeof(DiskRequest));
-	req->diskID = diskID;
-	req->process = currentProcess();
-	req->currentlyUsing = currentlyUsing;
+	memset(&diskTiming, 0, sizeof(DISK_TIMING));
+	diskTiming.Model = model;
+
+	switch(model) {
+
+	case DISK_TIMING_ROTATIONAL:
+		diskTiming.AccessTime = ROTATIONAL_ACCESS_TIME;
+		diskTiming.SeekTime = ROTATIONAL_SEEK_TIME;
+		diskTiming.SectorsPerTrack = ROTATIONAL_SECTORS_PER_TRACK;
+		diskTiming.RotationTime = ROTATIONAL_ROTATION_TIME;
+		break;
+
+	case DISK_TIMING_FLASH:
+		diskTiming.AccessTime = FLASH_ACCESS_TIME;
+		diskTiming.TransferTime = FLASH_TRANSFER_TIME;
+		diskTiming.Channels = FLASH_CHANNELS;
+		break;
 
-	QInsertOnTail(diskQueueId, req);
+	default:
+		diskTiming.Model = DISK_TIMING_LINEAR;
+		diskTiming.AccessTime = LINEAR_ACCESS_TIME;
+		diskTiming.SeekDivisor = LINEAR_SEEK_DIVISOR;
+		diskTiming.TransferTime = LINEAR_TRANSFER_TIME;
+		break;
+
+	}
 
 }
 
 /**
- * Removes from the disk queue the first
- * disk request that requested the given diskID.
+ * Gives a request to the disk hardware, which queues
+ * it behind any others it's working on.
+ * The caller must hold the disk lock.
  * Parameters:
- * diskID: the diskID that was requested
- * ignoreCurrentlyUsing: whether we should ignore processes using disk.
- * Returns: the first process found that requested that diskID,
- * or -1 if none found
+ * req: the request to start. Its disk must have
+ * fewer than DISK_QUEUE_DEPTH requests in flight.
  */
-Process* removeFromDiskQueue(long diskID, int ignoreCurrentlyUsing) {
+void startDiskRequest(DiskRequest* req) {
 
-	int i = 0;
-	DiskRequest* req = QWalk(diskQueueId, i);
+	MEMORY_MAPPED_IO mmio;
+	mmio.Mode = req->mode;
+	mmio.Field1 = req->diskID;
+	mmio.Field2 = req->sector;
+	mmio.Field3 = (long)req->buffer;
+	mmio.Field4 = 0;
 
-	//iterate through disk queue
-	//until we find a request for diskID.
-	//remove, then return it.
-	while((int)req != -1) {
+	//several sectors go as one vectored transfer.
+	//the hardware takes the buffer list when the command is
+	//given, so the vector doesn't need to outlive this call.
+	DISK_IO_VECTOR vector;
 
-		if(req->diskID == diskID) {
+	if(req->count > 1) {
 
-			if(ignoreCurrentlyUsing) {
+		vector.SectorCount = req->count;
 
-				if(req->currentlyUsing != 1) {
-					QRemoveItem(diskQueueId, req);
-					return req->process;
-				}
+		for(int i = 0; i < req->count; i++) {
+			vector.Buffers[i] = req->buffers[i];
+		}
 
-			} else {
+		mmio.Mode = req->mode == Z502DiskWrite ? Z502DiskWriteVector : Z502DiskReadVector;
+		mmio.Field3 = (long)&vector;
+
+	}
+
+	diskHeads[req->diskID] = req->sector + req->count - 1;
+	req->started = getTimeOfDay();
+	recordHistogram(&diskStats[req->diskID].queueWait, req->started - req->submitted);
+	MEM_WRITE(Z502Disk, &mmio);
+
+	//the disk hands back the tag its interrupt will carry.
+	req->tag = mmio.Field2;
+	diskInFlight[req->diskID][diskInFlightCounts[req->diskID]++] = req;
+
+}
+
+/**
+ * Adds a request to the queue of the disk it's for,
+ * to be started when that disk finishes its current one.
+ * Unless requests are served in arrival order, the
+ * queue is kept sorted by sector.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * req: the request to queue.
+ */
+void addToDiskQueue(DiskRequest* req) {
+
+	long diskID = req->diskID;
+
+	if(diskSchedulingPolicy == DISK_SCHED_FIFO) {
+		QInsertOnTail(diskQueueIds[diskID], req);
+	} else {
+		QInsert(diskQueueIds[diskID], req->sector, req);
+	}
+
+	if(diskQueuedCounts[diskID] == diskQueuedRoom[diskID]) {
+		diskQueuedRoom[diskID] = diskQueuedRoom[diskID] == 0 ? 16 : 2 * diskQueuedRoom[diskID];
+		diskQueued[diskID] = realloc(diskQueued[diskID], diskQueuedRoom[diskID] * sizeof(DiskRequest*));
+	}
 
-				QRemoveItem(diskQueueId, req);
-				return req->process;
+	req->queuedIndex = diskQueuedCounts[diskID];
+	diskQueued[diskID][diskQueuedCounts[diskID]++] = req;
 
+}
+
+/**
+ * Takes a request off the queue of the disk it's for.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * req: the request to take off. It must be queued.
+ */
+void removeFromDiskQueue(DiskRequest* req) {
+
+	long diskID = req->diskID;
+
+	QRemoveItem(diskQueueIds[diskID], req);
+
+	//move the last one into its place.
+	DiskRequest* last = diskQueued[diskID][--diskQueuedCounts[diskID]];
+	diskQueued[diskID][req->queuedIndex] = last;
+	last->queuedIndex = req->queuedIndex;
+
+}
+
+/**
+ * Whether two requests touch any of the same sectors of
+ * the same disk, with at least one of them writing. Such
+ * requests must reach the disk in the order they were made.
+ */
+int conflicts(DiskRequest* a, DiskRequest* b) {
+
+	if(a->diskID != b->diskID) {
+		return 0;
+	}
+
+	if(a->mode != Z502DiskWrite && b->mode != Z502DiskWrite) {
+		return 0;
+	}
+
+	return a->sector < b->sector + b->count && b->sector < a->sector + a->count;
+
+}
+
+/**
+ * Whether a request conflicts with one the disk is working on.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * req: the request to check.
+ */
+int waitsForFlight(DiskRequest* req) {
+
+	long diskID = req->diskID;
+
+	for(int i = 0; i < diskInFlightCounts[diskID]; i++) {
+
+		if(conflicts(req, diskInFlight[diskID][i])) {
+			return 1;
+		}
+
+	}
+
+	return 0;
+
+}
+
+/**
+ * Whether a request has to wait for an earlier one it
+ * conflicts with, that's either in flight or still queued.
+ * The disk reorders what it's given, so conflicting
+ * requests are never given to it together.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * req: the request to check.
+ */
+int mustWait(DiskRequest* req) {
+
+	long diskID = req->diskID;
+
+	if(waitsForFlight(req)) {
+		return 1;
+	}
+
+	for(int i = 0; i < diskQueuedCounts[diskID]; i++) {
+
+		DiskRequest* other = diskQueued[diskID][i];
+
+		if(other->sequence < req->sequence && conflicts(req, other)) {
+			return 1;
+		}
+
+	}
+
+	return 0;
+
+}
+
+/**
+ * Finds, for each sector a disk's queued requests touch, the
+ * earliest of them and the earliest write among them, so
+ * waitsInQueue can check a request without looking through
+ * the whole queue. Sectors the disk doesn't have are skipped:
+ * requests for them are refused, so their order doesn't matter.
+ * The caller must hold the disk lock until it's done with the scan.
+ * Parameters:
+ * diskID: the disk to scan.
+ */
+void scanDiskQueue(long diskID) {
+
+	DiskRequest** queued = diskQueued[diskID];
+
+	//only the sectors we're about to fill in need clearing.
+	for(int i = 0; i < diskQueuedCounts[diskID]; i++) {
+
+		for(long sector = queued[i]->sector; sector < queued[i]->sector + queued[i]->count; sector++) {
+
+			if(sector >= 0 && sector < NUMBER_LOGICAL_SECTORS) {
+				firstQueuedAt[sector] = LONG_MAX;
+				firstWriteAt[sector] = LONG_MAX;
 			}
 
 		}
 
-		++i;
-		req = QWalk(diskQueueId, i);
+	}
+
+	for(int i = 0; i < diskQueuedCounts[diskID]; i++) {
+
+		DiskRequest* req = queued[i];
+
+		for(long sector = req->sector; sector < req->sector + req->count; sector++) {
+
+			if(sector < 0 || sector >= NUMBER_LOGICAL_SECTORS) {
+				continue;
+			}
+
+			if(req->sequence < firstQueuedAt[sector]) {
+				firstQueuedAt[sector] = req->sequence;
+			}
+
+			if(req->mode == Z502DiskWrite && req->sequence < firstWriteAt[sector]) {
+				firstWriteAt[sector] = req->sequence;
+			}
+
+		}
 
 	}
 
-	return (Process*)-1;
+}
+
+/**
+ * Whether a queued request conflicts with an earlier one
+ * still queued, using the last scanDiskQueue of its disk.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * req: the request to check.
+ */
+int waitsInQueue(DiskRequest* req) {
+
+	for(long sector = req->sector; sector < req->sector + req->count; sector++) {
+
+		if(sector < 0 || sector >= NUMBER_LOGICAL_SECTORS) {
+			continue;
+		}
+
+		//a write waits for anything earlier, a read only for writes.
+		long earliest = req->mode == Z502DiskWrite ? firstQueuedAt[sector] : firstWriteAt[sector];
+
+		if(earliest < req->sequence) {
+			return 1;
+		}
+
+	}
+
+	return 0;
 
 }
 
 /**
- * Writes to a disk with a given ID at a given sector.
+ * Removes from a disk's queue the request it should serve next.
+ * A request that has waited longer than DISK_STARVATION_TIME
+ * goes first, so far away sectors are never put off forever.
+ * Requests that must wait for an earlier one are skipped.
+ * The caller must hold the disk lock.
  * Parameters:
- * diskID: the diskID to write to.
- * sector: the sector to write to.
- * writeBuffer: the address of outgoing data.
+ * diskID: the disk to pick for.
+ * Returns: the request, or -1 if none can be served.
  */
-void writeToDisk(long diskID, long sector, char* writeBuffer) {
+DiskRequest* removeNextDiskRequest(long diskID) {
 
+	if(diskSchedulingPolicy == DISK_SCHED_FIFO) {
 
-	//ask disk to write.
-	MEMORY_MAPPED_IO mmio;
-	mmio.Mode = Z502DiskWrite;
-	mmio.Field1 = diskID;
-	mmio.Field2 = sector;
-	mmio.Field3 = (long)writeBuffer;
+		DiskRequest* first = (DiskRequest*)QNextItemInfo(diskQueueIds[diskID]);
+
+		if((int)first == -1 || mustWait(first)) {
+			return (DiskRequest*)-1;
+		}
+
+		removeFromDiskQueue(first);
+		return first;
 
-	//if the disk is being used, wait.
-	/*while(getDiskStatus(diskID) == DEVICE_IN_USE) {
-		addToDiskQueue(diskID);
-		diskUnlock();
-		dispatch();
 	}
 
-	diskUnlock();
+	long head = diskHeads[diskID];
+	long now = getTimeOfDay();
 
-	diskLock();
-	MEM_WRITE(Z502Disk, &mmio);
+	DiskRequest* oldest = (DiskRequest*)-1;
+	DiskRequest* lowest = (DiskRequest*)-1;
+	DiskRequest* next = (DiskRequest*)-1; //the first at or above the head.
+	DiskRequest* closest = (DiskRequest*)-1;
+	long closestDistance = 0;
 
-	//we have to wait for the disk to finish before we continue.
-	addToDiskQueue(diskID);
-	diskUnlock();
-	dispatch();*/
+	//one pass finds every candidate. ties go to the earlier request.
+	scanDiskQueue(diskID);
 
-	while(1) {
+	for(int i = 0; i < diskQueuedCounts[diskID]; i++) {
 
-		diskLock();
+		DiskRequest* req = diskQueued[diskID][i];
+		long distance = labs(req->sector - head);
 
-		if(getDiskStatus(diskID) == DEVICE_IN_USE) {
+		if(waitsForFlight(req) || waitsInQueue(req)) {
+			continue;
+		}
 
-			addToDiskQueue(diskID, 0);
-			diskUnlock();
-			dispatch();
+		if((int)lowest == -1 || req->sector < lowest->sector
+				|| (req->sector == lowest->sector && req->sequence < lowest->sequence)) {
+			lowest = req;
+		}
+
+		if((int)oldest == -1 || req->submitted < oldest->submitted
+				|| (req->submitted == oldest->submitted && req->sequence < oldest->sequence)) {
+			oldest = req;
+		}
+
+		if(req->sector >= head && ((int)next == -1 || req->sector < next->sector
+				|| (req->sector == next->sector && req->sequence < next->sequence))) {
+			next = req;
+		}
 
+		if((int)closest == -1 || distance < closestDistance
+				|| (distance == closestDistance && (req->sector < closest->sector
+				|| (req->sector == closest->sector && req->sequence < closest->sequence)))) {
+			closest = req;
+			closestDistance = distance;
+		}
+
+	}
+
+	if((int)lowest == -1) {
+		return lowest;
+	}
+
+	DiskRequest* chosen;
+
+	if(now - oldest->submitted > DISK_STARVATION_TIME) {
+		chosen = oldest;
+	} else if(diskSchedulingPolicy == DISK_SCHED_SSTF) {
+		chosen = closest;
+	} else {
+		//C-LOOK: past the highest waiting sector, wrap to the lowest.
+		chosen = (int)next != -1 ? next : lowest;
+	}
+
+	removeFromDiskQueue(chosen);
+	return chosen;
+
+}
+
+/**
+ * Marks a request done without the disk, waking its waiter.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * req: the request to finish.
+ */
+void finishWithoutDisk(DiskRequest* req) {
+
+	//read this before marking it done: once it's
+	//done its waiter may free it at any time.
+	Process* process = req->process;
+	req->done = 1;
+
+	if(req->abandoned) {
+		free(req);
+	}
+
+	if((int)process != -1) {
+		traceEvent(TRACE_WAKE, process, TRACE_REASON_DISK);
+		wakeProcess(process);
+	}
+
+}
+
+/**
+ * Looks for the latest unfinished write that covers every
+ * sector a read wants, so the read can copy from its buffers.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * read: the read to satisfy.
+ * Returns the write, or -1 if there's none, or if a later
+ * write covers only some of the sectors.
+ */
+DiskRequest* findPendingWrite(DiskRequest* read) {
+
+	long diskID = read->diskID;
+	DiskRequest* latest = (DiskRequest*)-1; //the latest write touching the read.
+	DiskRequest* write;
+
+	//in flight first, then queued.
+	for(int i = 0; i < diskInFlightCounts[diskID] + diskQueuedCounts[diskID]; i++) {
+
+		if(i < diskInFlightCounts[diskID]) {
+			write = diskInFlight[diskID][i];
 		} else {
+			write = diskQueued[diskID][i - diskInFlightCounts[diskID]];
+		}
 
-			MEM_WRITE(Z502Disk, &mmio);
-			addToDiskQueue(diskID, 1);
-			diskUnlock();
-			dispatch();
+		if(conflicts(read, write) && ((int)latest == -1 || write->sequence > latest->sequence)) {
+			latest = write;
+		}
+
+	}
+
+	if((int)latest == -1 || latest->sector > read->sector
+			|| latest->sector + latest->count < read->sector + read->count) {
+		return (DiskRequest*)-1;
+	}
+
+	return latest;
+
+}
+
+/**
+ * Drops queued writes that a new write entirely overwrites,
+ * finishing them straight away. A write that some queued
+ * read still needs to see is kept.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * write: the new write.
+ */
+void mergeQueuedWrites(DiskRequest* write) {
+
+	long diskID = write->diskID;
+
+	//a write it covers lies within its sectors, so only reads of
+	//those sectors can need one. mark them once, up front.
+	int readAt[MAX_DISK_IO_VECTOR];
+	memset(readAt, 0, sizeof(readAt));
+
+	for(int i = 0; i < diskQueuedCounts[diskID]; i++) {
+
+		DiskRequest* reader = diskQueued[diskID][i];
+
+		if(reader->mode != Z502DiskRead) {
+			continue;
+		}
+
+		for(long sector = reader->sector; sector < reader->sector + reader->count; sector++) {
+
+			if(sector >= write->sector && sector < write->sector + write->count) {
+				readAt[sector - write->sector] = 1;
+			}
+
+		}
+
+	}
+
+	int i = 0;
+
+	while(i < diskQueuedCounts[diskID]) {
+
+		DiskRequest* old = diskQueued[diskID][i];
+
+		int covered = old->mode == Z502DiskWrite && write->sector <= old->sector
+				&& old->sector + old->count <= write->sector + write->count;
+
+		for(long sector = old->sector; covered && sector < old->sector + old->count; sector++) {
+
+			if(readAt[sector - write->sector]) {
+				covered = 0;
+			}
+
+		}
+
+		//taking it off moves the last one into its place.
+		if(covered) {
+			removeFromDiskQueue(old);
+			++diskStats[diskID].merged;
+			changeOutstanding(diskID, -1);
+			finishWithoutDisk(old);
+		} else {
+			++i;
+		}
+
+	}
+
+}
+
+/**
+ * Called when a disk interrupts. Marks the request the
+ * interrupt is for as done, then tops the disk's queue
+ * back up from the requests waiting for it, so at most
+ * one process needs waking per interrupt.
+ * The caller must hold the disk lock.
+ * Parameters:
+ * diskID: the disk that finished.
+ * tag: the tag the interrupt carried.
+ * error: the status the interrupt carried.
+ * Returns: the process waiting for the finished request,
+ * or -1 if nobody is waiting for it yet.
+ */
+Process* finishDiskRequest(long diskID, long tag, long error) {
+
+	DiskRequest* done = (DiskRequest*)-1;
+
+	for(int i = 0; i < diskInFlightCounts[diskID]; i++) {
+
+		if(diskInFlight[diskID][i]->tag == tag) {
+			done = diskInFlight[diskID][i];
+			diskInFlight[diskID][i] = diskInFlight[diskID][--diskInFlightCounts[diskID]];
 			break;
+		}
+
+	}
+
+	Process* process = (Process*)-1;
+
+	//read this before marking it done: once it's
+	//done its waiter may free it at any time.
+	if((int)done != -1) {
+
+		DiskStats* stats = &diskStats[diskID];
+		long now = getTimeOfDay();
+
+		//a refused request never moved the head or any data.
+		if(error != ERR_SUCCESS) {
+			++stats->errors;
+		} else {
+
+			if(done->mode == Z502DiskWrite) {
+				++stats->writes;
+			} else {
+				++stats->reads;
+			}
+
+			//the disk serves one request at a time, so requests
+			//finish in the order the head visits them.
+			stats->sectors += done->count;
+			recordHistogram(&stats->seek, labs(done->sector - stats->lastSector));
+			stats->lastSector = done->sector + done->count - 1;
+			recordHistogram(&stats->service, now - done->started);
+
+		}
+
+		recordHistogram(&stats->latency, now - done->submitted);
+		changeOutstanding(diskID, -1);
 
+		process = done->process;
+		done->error = error;
+		done->done = 1;
+
+		if(done->abandoned) {
+			free(done);
 		}
 
 	}
 
+	while(diskInFlightCounts[diskID] < DISK_QUEUE_DEPTH) {
+
+		DiskRequest* next = removeNextDiskRequest(diskID);
+
+		if((int)next == -1) {
+			break;
+		}
+
+		startDiskRequest(next);
+
+	}
+
+	return process;
+
 }
 
-/*
- * Whether 2 buffers are equal.
+/**
+ * Starts a read or write without waiting for it. If the disk's
+ * queue is full, the request waits its turn and is started by
+ * the interrupt handler when there's room. The buffer must
+ * stay untouched until the request is waited for.
+ * Parameters:
+ * diskID: the disk to use.
+ * mode: Z502DiskRead or Z502DiskWrite.
+ * sector: the sector to read or write.
+ * buffer: where the data comes from or goes to.
+ * Returns a handle for the request. It must be
+ * given to waitForDiskRequest exactly once.
  */
-int areEqual(char* buf1, char* buf2) {
+DiskRequest* submitDiskRequest(long diskID, long mode, long sector, char* buffer) {
 
-	for(int i = 0; i<PGSIZE; i++) {
+	return submitDiskVector(diskID, mode, sector, 1, &buffer);
+
+}
+
+/**
+ * Starts a read or write of several consecutive sectors
+ * without waiting for it. The disk moves them all in one
+ * transfer, with a single seek and a single interrupt.
+ * Works like submitDiskRequest otherwise.
+ * Parameters:
+ * diskID: the disk to use.
+ * mode: Z502DiskRead or Z502DiskWrite.
+ * sector: the first sector to read or write.
+ * count: how many sectors, up to MAX_DISK_IO_VECTOR.
+ * buffers: one buffer per sector. The list is copied, but the
+ * buffers must stay untouched until the request is waited for.
+ * Returns a handle for the request. It must be
+ * given to waitForDiskRequest exactly once.
+ */
+DiskRequest* submitDiskVector(long diskID, long mode, long sector, int count, char** buffers) {
+
+	DiskRequest* req = malloc(sizeof(DiskRequest));
+	req->diskID = diskID;
+	req->process = (Process*)-1;
+	req->mode = mode;
+	req->sector = sector;
+	req->count = count;
+	req->buffer = buffers[0];
+
+	//callers may pass a list that's a local.
+	memcpy(req->buffers, buffers, count * sizeof(char*));
+	req->submitted = getTimeOfDay();
+	req->done = 0;
+	req->error = ERR_SUCCESS;
+	req->abandoned = 0;
+
+	diskLock();
+
+	req->sequence = ++diskSequence;
+
+	if(mode == Z502DiskRead) {
+
+		//a write that hasn't reached the disk yet has the latest data.
+		DiskRequest* write = findPendingWrite(req);
+
+		if((int)write != -1) {
+
+			for(int i = 0; i < count; i++) {
+				memcpy(req->buffers[i], write->buffers[req->sector - write->sector + i], PGSIZE);
+			}
+
+			++diskStats[diskID].readsFromWrites;
+			req->done = 1;
+			diskUnlock();
+			return req;
 
-		if(buf1[i] != buf2[i]) {
-			return 0;
 		}
 
+	} else {
+		mergeQueuedWrites(req);
 	}
 
-	return 1;
+	recordHistogram(&diskStats[diskID].depth, diskStats[diskID].outstanding);
+	changeOutstanding(diskID, 1);
+
+	if(diskInFlightCounts[diskID] < DISK_QUEUE_DEPTH && !mustWait(req)) {
+		startDiskRequest(req);
+	} else {
+		++diskStats[diskID].queuedOnArrival;
+		addToDiskQueue(req);
+	}
+
+	diskUnlock();
+
+	return req;
 
 }
 
 /**
- * Reads from a disk with a given ID at a given sector.
+ * Waits for a submitted request to finish, then frees it.
+ * Returns straight away if it has already finished.
  * Parameters:
- * diskID: the diskID to read from.
- * sector: the sector to read from.
- * readBuffer: the address to send the data to.
+ * req: the handle submitDiskRequest returned.
  */
-void readFromDisk(long diskID, long sector, char* readBuffer) {
+void waitForDiskRequest(DiskRequest* req) {
 
-	//ask for disk read.
-	MEMORY_MAPPED_IO mmio;
-	mmio.Mode = Z502DiskRead;
-	mmio.Field1 = diskID;
-	mmio.Field2 = sector;
-	mmio.Field3 = (long)readBuffer;
+	diskLock();
 
-	//if the disk is being used, wait.
-	/*while(getDiskStatus(diskID) == DEVICE_IN_USE) {
-		addToDiskQueue(diskID);
+	if(!req->done) {
+
+		req->process = currentProcess();
+		traceEvent(TRACE_BLOCK, req->process, TRACE_REASON_DISK);
+		setScheduleState(req->process, SCHED_STATE_DISK);
 		diskUnlock();
 		dispatch();
+
+	} else {
+		diskUnlock();
 	}
 
-	diskUnlock();
+	free(req);
+
+}
+
+/**
+ * Forgets the process waiting for a disk request because
+ * it has been terminated, so it isn't woken when the request
+ * finishes. The request still goes to the disk, and is
+ * freed when it finishes, since its waiter is gone.
+ * Parameters:
+ * process: the terminated process.
+ */
+void abandonDiskWait(Process* process) {
 
 	diskLock();
-	MEM_WRITE(Z502Disk, &mmio);
 
-	//we have to wait for the disk to finish before we continue.
-	addToDiskQueue(diskID);
+	for(long diskID = 0; diskID < MAX_NUMBER_OF_DISKS; diskID++) {
+
+		int inFlight = diskInFlightCounts[diskID];
+
+		for(int i = 0; i < inFlight + diskQueuedCounts[diskID]; i++) {
+
+			DiskRequest* req = i < inFlight ? diskInFlight[diskID][i]
+					: diskQueued[diskID][i - inFlight];
+
+			if(req->process == process) {
+				req->process = (Process*)-1;
+				req->abandoned = 1;
+				diskUnlock();
+				return;
+			}
+
+		}
+
+	}
+
 	diskUnlock();
-	dispatch();*/
 
-	while(1) {
+}
 
-		diskLock();
+/**
+ * Writes to a disk with a given ID at a given sector.
+ * Parameters:
+ * diskID: the diskID to write to.
+ * sector: the sector to write to.
+ * writeBuffer: the address of outgoing data.
+ */
+void writeToDisk(long diskID, long sector, char* writeBuffer) {
 
-		if(getDiskStatus(diskID) == DEVICE_IN_USE) {
+	waitForDiskRequest(submitDiskRequest(diskID, Z502DiskWrite, sector, writeBuffer));
 
-			//aprintf("Process %d add from read: DISK IN USE.\n", currentProcess()->pid);
-			addToDiskQueue(diskID, 0);
-			diskUnlock();
-			//aprintf("Process %d dispatching: DISK IN USE.\n", currentProcess()->pid);
-			dispatch();
+}
 
-		} else {
+/*
+ * Whether 2 buffers are equal.
+ */
+int areEqual(char* buf1, char* buf2) {
 
-			MEM_WRITE(Z502Disk, &mmio);
-			//aprintf("Process %d add from read: STARTED READ.\n", currentProcess()->pid);
-			addToDiskQueue(diskID, 1);
-			diskUnlock();
-			//aprintf("Process %d dispatching: STARTED READ.\n", currentProcess()->pid);
-			dispatch();
-			break;
+	for(int i = 0; i<PGSIZE; i++) {
 
+		if(buf1[i] != buf2[i]) {
+			return 0;
 		}
 
 	}
 
-	//while(areEqual(readBuffer, tempBuffer));
+	return 1;
+
+}
+
+/**
+ * Reads from a disk with a given ID at a given sector.
+ * Parameters:
+ * diskID: the diskID to read from.
+ * sector: the sector to read from.
+ * readBuffer: the address to send the data to.
+ */
+void readFromDisk(long diskID, long sector, char* readBuffer) {
+
+	waitForDiskRequest(submitDiskRequest(diskID, Z502DiskRead, sector, readBuffer));
 
 }
 
 /*
  * Checks a disk with a given ID. Prints the disk's contents to a file.
+ * File data still waiting in the buffer cache is written first.
  * Parameters:
  * diskID: the ID of the disk to check.
  */
 void checkDisk(long diskID) {
 
+	writeBackCache(-1);
 	flushDiskContents(diskID);
 
 	//make request to hardware to check the disk.
@@ -267,3 +933,112 @@ long getDiskStatus(long diskID) {
 	return mmio.Field2;
 
 }
+
+/*
+ * Asks a disk where its head is.
+ * Parameters:
+ * diskID: the ID of the disk to check.
+ * Returns the sector the disk last moved its head to.
+ */
+long getDiskHead(long diskID) {
+	MEMORY_MAPPED_IO mmio;
+	mmio.Mode = Z502Status;
+	mmio.Field1 = diskID;
+	mmio.Field2 = 0;
+	mmio.Field3 = 0;
+	mmio.Field4 = 0;
+
+	MEM_READ(Z502Disk, &mmio);
+	return mmio.Field3;
+
+}
+
+/**
+ * Whether a disk has nothing in flight and nothing waiting.
+ * Parameters:
+ * diskID: the ID of the disk to check.
+ */
+int isDiskIdle(long diskID) {
+
+	diskLock();
+	int idle = diskInFlightCounts[diskID] == 0 && diskQueuedCounts[diskID] == 0;
+	diskUnlock();
+
+	return idle;
+
+}
+
+/**
+ * Prints a histogram as one line of bucket counts,
+ * leaving out empty buckets.
+ * Parameters:
+ * name: what the histogram measures.
+ * histogram: the histogram to print.
+ */
+void printDiskHistogram(char* name, DiskHistogram* histogram) {
+
+	if(histogram->samples == 0) {
+		return;
+	}
+
+	aprintf("  %-10s avg %6ld max %6ld |", name,
+			histogram->total / histogram->samples, histogram->max);
+
+	for(int i = 0; i < DISK_HISTOGRAM_BUCKETS; i++) {
+
+		if(histogram->counts[i] == 0) {
+			continue;
+		}
+
+		long low = i == 0 ? 0 : 1L << (i - 1);
+
+		if(i == DISK_HISTOGRAM_BUCKETS - 1) {
+			aprintf(" %ld+:%ld", low, histogram->counts[i]);
+		} else {
+			aprintf(" %ld-%ld:%ld", low, (1L << i) - 1, histogram->counts[i]);
+		}
+
+	}
+
+	aprintf("\n");
+
+}
+
+/**
+ * Prints the statistics of every disk that was used.
+ * Times are in simulated time units, seeks in sectors.
+ */
+void printDiskStats() {
+
+	aprintf("\nDisk statistics\n");
+
+	diskLock();
+
+	for(int i = 0; i < MAX_NUMBER_OF_DISKS; i++) {
+
+		DiskStats* stats = &diskStats[i];
+
+		if(stats->reads + stats->writes + stats->errors + stats->merged + stats->readsFromWrites == 0) {
+			continue;
+		}
+
+		changeOutstanding(i, 0);
+		long elapsed = stats->lastDepthChange > 0 ? stats->lastDepthChange : 1;
+
+		aprintf("Disk %d: %ld reads, %ld writes, %ld errors, %ld sectors, %ld merged, %ld reads from writes, "
+				"%ld queued on arrival, average depth %ld.%02ld\n",
+				i, stats->reads, stats->writes, stats->errors, stats->sectors, stats->merged,
+				stats->readsFromWrites, stats->queuedOnArrival,
+				stats->depthArea / elapsed, (stats->depthArea * 100 / elapsed) % 100);
+
+		printDiskHistogram("wait", &stats->queueWait);
+		printDiskHistogram("service", &stats->service);
+		printDiskHistogram("latency", &stats->latency);
+		printDiskHistogram("seek", &stats->seek);
+		printDiskHistogram("depth", &stats->depth);
+
+	}
+
+	diskUnlock();
+
+}
@@ -10,14 +10,123 @@
 #define DISKMANAGER_H_
 #include "moreGlobals.h"
 
+//orders in which a disk serves its waiting requests.
+#define DISK_SCHED_FIFO 0 //arrival order.
+#define DISK_SCHED_CLOOK 1 //sweep up through the sectors, then jump back to the lowest.
+#define DISK_SCHED_SSTF 2 //closest sector to the head first.
+
+//a request waiting longer than this is served next, whatever its sector.
+#define DISK_STARVATION_TIME 2000
+
+//parameters of the disk timing models. see DISK_TIMING in global.h.
+//linear: what the hardware uses unless told otherwise.
+#define LINEAR_ACCESS_TIME 100
+#define LINEAR_SEEK_DIVISOR 20
+#define LINEAR_TRANSFER_TIME 10
+//rotational: 32 tracks of 64 sectors.
+#define ROTATIONAL_ACCESS_TIME 20
+#define ROTATIONAL_SEEK_TIME 4
+#define ROTATIONAL_SECTORS_PER_TRACK 64
+#define ROTATIONAL_ROTATION_TIME 128
+//flash: no seek, 4 channels.
+#define FLASH_ACCESS_TIME 25
+#define FLASH_TRANSFER_TIME 10
+#define FLASH_CHANNELS 4
+
+//histogram buckets go up in powers of 2: the first holds 0,
+//bucket i holds values from 2^(i-1) up to 2^i - 1, and the
+//last holds everything bigger.
+#define DISK_HISTOGRAM_BUCKETS 16
+
+//struct for a histogram of some measure of disk requests.
+//counts: how many values fell in each bucket.
+//samples: how many values were recorded.
+//total: the sum of every value.
+//max: the largest value.
+struct DiskHistogram {
+	long counts[DISK_HISTOGRAM_BUCKETS];
+	long samples;
+	long total;
+	long max;
+};
+
+typedef struct DiskHistogram DiskHistogram;
+
+//struct for the statistics of one disk.
+//reads, writes: requests that reached the disk.
+//errors: requests the disk refused. these move no sectors.
+//sectors: sectors moved by those requests.
+//queueWait: time from submission until given to the disk.
+//service: time from being given to the disk until it interrupted.
+//the disk's own queue counts as service.
+//latency: time from submission until done.
+//seek: distance from the last sector served to the next one.
+//depth: requests outstanding on the disk when each one arrived.
+//queuedOnArrival: requests that found the disk full or had to wait for an earlier one.
+//merged: writes dropped because a later write covered them.
+//readsFromWrites: reads served from an unfinished write's buffers.
+//outstanding: requests submitted and not yet done.
+//depthArea: outstanding integrated over time, for the average depth.
+//lastDepthChange: when outstanding last changed.
+//lastSector: the last sector the disk served.
+struct DiskStats {
+	long reads;
+	long writes;
+	long errors;
+	long sectors;
+	DiskHistogram queueWait;
+	DiskHistogram service;
+	DiskHistogram latency;
+	DiskHistogram seek;
+	DiskHistogram depth;
+	long queuedOnArrival;
+	long merged;
+	long readsFromWrites;
+	int outstanding;
+	long depthArea;
+	long lastDepthChange;
+	long lastSector;
+};
+
+typedef struct DiskStats DiskStats;
+
 void initDiskManager();
+void setDiskTimingModel(int model);
+DiskRequest* submitDiskRequest(long diskID, long mode, long sector, char* buffer);
+DiskRequest* submitDiskVector(long diskID, long mode, long sector, int count, char** buffers);
+void waitForDiskRequest(DiskRequest* req);
+void abandonDiskWait(Process* process);
 void writeToDisk(long diskID, long sector, char* writeBuffer);
 void readFromDisk(long diskID, long sector, char* readBuffer);
 void checkDisk(long diskID);
+void printDiskStats();
 long getDiskStatus(long diskID);
-void addToDiskQueue(long diskID, int currentlyUsing);
-Process* removeFromDiskQueue(long diskID, int ignoreCurrentlyUsing);
+long getDiskHead(long diskID);
+int isDiskIdle(long diskID);
+void addToDiskQueue(DiskRequest* req);
+Process* finishDiskRequest(long diskID, long tag, long error);
 int areEqual(char* buf1, char* buf2);
 
-int diskQueueId;
+//one queue of waiting requests per disk.
+int diskQueueIds[MAX_NUMBER_OF_DISKS];
+
+//the same requests in no particular order, so they
+//can be looked through without walking the queue.
+DiskRequest** diskQueued[MAX_NUMBER_OF_DISKS];
+int diskQueuedCounts[MAX_NUMBER_OF_DISKS];
+int diskQueuedRoom[MAX_NUMBER_OF_DISKS];
+
+//the requests each disk has been given and not finished,
+//up to the depth of the disk's own queue.
+DiskRequest* diskInFlight[MAX_NUMBER_OF_DISKS][DISK_QUEUE_DEPTH];
+int diskInFlightCounts[MAX_NUMBER_OF_DISKS];
+
+//the sector each disk's head was last sent to.
+long diskHeads[MAX_NUMBER_OF_DISKS];
+
+int diskSchedulingPolicy; //one of the DISK_SCHED_ orders.
+
+DISK_TIMING diskTiming; //the timing model every disk is given.
+
+DiskStats diskStats[MAX_NUMBER_OF_DISKS];
 #endif /* DISKMANAGER_H_ */
@@ -15,302 +15,1383 @@
 #include "processManager.h"
 #include "moreGlobals.h"
 #include "diskManager.h"
+#include "schedTrace.h"
 #include "fileSystem.h"
-
-void schedulePrint();
+#include "interlockManager.h"
+
+void schedulePrint(Process* running);
+int freeProcessors();
+int countFreeProcessors();
+void startOnProcessor(Process* process, int processor);
+int startGang(long groupId);
+int gangHoldExpired(long groupId);
+int chooseProcessor(Process* process);
+void readyCursorStart(ReadyCursor* cursor);
+Process* readyCursorNext(ReadyCursor* cursor);
+void markDispatched(Process* process);
 int inReadyQueue(long pid);
+Process* findReady(long pid);
+void retireEdfProcess(Process* process);
 int inSuspendQueue(long pid);
 void multiDispatch();
+void leaveWaits(Process* process);
+
+int numSchedulePrints = 0;
+
+//the largest number of processes a state set can hold.
+#define MAX_STATE_MEMBERS (MAX_NUMBER_OF_USER_THREADS + 1)
+
+//the processes in each scheduling state, in no particular order.
+//kept up to date on every transition so schedule prints
+//don't have to walk the queues.
+Process* stateMembers[NUM_SCHED_STATES][MAX_STATE_MEMBERS];
+int stateCounts[NUM_SCHED_STATES];
+
+//reused by every schedule print. the running and
+//terminated lists are never filled, so stay zeroed.
+SP_INPUT_DATA spData = { .TargetAction = "Dispatch" };
+
+double edfUtilisation = 0; //the total density of all admitted EDF processes.
+long retiredEdfJobs = 0; //EDF jobs completed by processes that have terminated.
+long retiredDeadlineMisses = 0; //deadline misses of processes that have terminated.
+long retiredBudgetOverruns = 0; //budget overruns of processes that have terminated.
+int edfUsed = 0; //whether any process has ever joined the EDF class.
+
+RBTree fairTree; //ready normal processes under the fair policy, keyed by vruntime.
+long minVruntime = 0; //the smallest vruntime handed the CPU so far.
+
+//the process running on each processor in M mode, or NULL if it's free.
+//we never start more contexts than there are processors.
+Process* runningOn[MAX_NUMBER_OF_PROCESSORS];
+
+//how many ready processes last ran on each processor.
+int readyWaitingFor[MAX_NUMBER_OF_PROCESSORS];
+
+//how many times a process has been started on a processor in M mode.
+long dispatchCount = 0;
+
+//the group free processors are being held for, and since when.
+long gangHeldFor = 0;
+long gangHeldSince = 0;
+
+double edfDensity(Process* process);
+
+/**
+ * Sets up the ready queue for use.
+ */
+void initReadyQueue() {
+	readyQueueId = QCreate("readyQueue");
+	edfQueueId = QCreate("edfQueue");
+	rbInit(&fairTree);
+}
+
+/**
+ * Sets up the suspend queue for use.
+ */
+void initSuspendQueue() {
+	suspendQueueId = QCreate("susQueue");
+}
+
+/**
+ * The following code plays the role of the scheduler
+ * in a uniprocessor operating system.
+ * It either starts the next ready process
+ * with the greatest priority or waits if there
+ * are no ready processes.
+ */
+void dispatch() {
+
+	//whoever called us is giving up the CPU.
+	Process* current = currentProcess();
+	if((int)current != -1) {
+		chargeRuntime(current);
+	}
+
+	if(numProcessors > 1) {
+		multiDispatch();
+		return;
+	}
+
+	//pass time if there are no ready processes.
+	while(readyQueueIsEmpty()) {
+		CALL();
+	}
+
+	schedulePrint(current);
+
+	//if we reach here, there is a ready process.
+	//get next process off of queue and start it.
+	readyLock();
+	Process* nextProcess = removeNextReady();
+	readyUnlock();
+
+	markDispatched(nextProcess);
+
+	MEMORY_MAPPED_IO mmio;
+	mmio.Mode = Z502StartContext;
+	mmio.Field1 = nextProcess->contextId;
+	mmio.Field2 = START_NEW_CONTEXT_AND_SUSPEND;
+	mmio.Field3 = 0;
+	mmio.Field4 = 0;
+
+	MEM_WRITE(Z502Context, &mmio);
+
+	//if there was an error, stop.
+	if(mmio.Field4 == ERR_BAD_PARAM) {
+		aprintf("Error starting another process from dispatch.\n");
+		exit(0);
+	}
+
+}
+
+/**
+ * Carries out multiprocessing dispatching
+ * for this current process. It should suspend
+ * until the dispatching process wakes it up,
+ * then schedule print.
+ */
+void multiDispatch() {
+
+	//give up our processor so another process can be started on it.
+	Process* current = currentProcess();
+	if((int)current != -1) {
+
+		readyLock();
+		releaseProcessor(current);
+		int dying = current->terminatePending;
+		readyUnlock();
+
+		//terminated while it ran. rather than wait, it goes now.
+		if(dying) {
+			terminateProcess(-1);
+			return;
+		}
+
+	}
+
+	//suspend this current one.
+	MEMORY_MAPPED_IO mmio;
+	mmio.Mode = Z502StartContext;
+	mmio.Field1 = 0;
+	mmio.Field2 = SUSPEND_CURRENT_CONTEXT_ONLY;
+	mmio.Field3 = 0;
+	mmio.Field4 = 0;
+
+	//if((int)currentProcess() != -1)
+	//aprintf("Process %d about to dispatch suspend\n", currentProcess()->pid);
+	MEM_WRITE(Z502Context, &mmio);
+
+	schedulePrint(current);
+}
+
+/**
+ * The code required to make the multidispatcher
+ * start running.
+ */
+void startMultidispatcher() {
+	SYSTEM_CALL_DATA *SystemCallData =
+		 (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA));
+	SystemCallData->NumberOfArguments = -1;
+	SystemCallData->SystemCallNumber = SYSNUM_MULTIDISPATCH;
+	ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );
+	SoftwareTrap(SystemCallData);
+	free(SystemCallData);
+
+}
+
+/**
+ * This following code plays the role of the
+ * scheduler in a multiprocessor system.
+ * It starts processes found in the ready
+ * queue as long as there are free processors.
+ * The rest wait on the ready queue until
+ * a running process gives up its processor.
+ * Processes are placed back on the processor
+ * they last ran on where possible, and the
+ * members of a process group are started together.
+ */
+void multidispatcher() {
+
+	while(1) {
+
+		int started = 0;
+
+		if(!readyQueueIsEmpty() && freeProcessors() > 0) {
+
+			readyLock();
+
+			//find the first ready process, in dispatch order,
+			//that one of the free processors should take.
+			//we stop walking as soon as we start anything.
+			ReadyCursor cursor;
+			readyCursorStart(&cursor);
+			Process* proc = readyCursorNext(&cursor);
+			int mayHold = 1;
+
+			//groups already tried in this scan and what startGang said,
+			//so each group's members are gathered at most once per scan.
+			long triedGroups[MAX_GANGS_PER_SCAN];
+			int triedResults[MAX_GANGS_PER_SCAN];
+			int triedCount = 0;
+
+			while((int)proc != -1) {
+
+				//a group goes all at once. if it doesn't fit yet,
+				//we hold the free processors for the first such group
+				//rather than let processes behind it take them, but
+				//only for so long. its members are never started alone.
+				if(proc->groupId != 0) {
+
+					int gang;
+					int t = 0;
+
+					while(t < triedCount && triedGroups[t] != proc->groupId) {
+						t++;
+					}
+
+					if(t < triedCount) {
+						gang = triedResults[t];
+					} else {
+
+						gang = startGang(proc->groupId);
+
+						if(triedCount < MAX_GANGS_PER_SCAN) {
+							triedGroups[triedCount] = proc->groupId;
+							triedResults[triedCount++] = gang;
+						}
+
+					}
+
+					if(gang > 0) {
+						started = 1;
+						break;
+					}
+
+					if(gang == 0) {
+
+						if(mayHold && !gangHoldExpired(proc->groupId)) {
+							break;
+						}
+
+						mayHold = 0;
+						proc = readyCursorNext(&cursor);
+						continue;
+
+					}
+
+					//too big to ever run together. it's
+					//scheduled like any other process.
+
+				}
+
+				int processor = chooseProcessor(proc);
+
+				if(processor != -1) {
+					startOnProcessor(proc, processor);
+					started = 1;
+					break;
+				}
+
+				proc = readyCursorNext(&cursor);
+
+			}
+
+			readyUnlock();
+
+		}
+
+		//nothing we could start. let time pass.
+		if(!started) {
+			CALL();
+		}
+
+	}
+
+}
+
+/**
+ * Moves a process into one of the state sets
+ * used for schedule prints, taking it out of
+ * whichever set it was in before.
+ * Parameters:
+ * process: the process changing state.
+ * state: one of the SCHED_STATE values.
+ */
+void setScheduleState(Process* process, int state) {
+
+	stateLock();
+
+	//take it out of its old set by moving the last member into its place.
+	if(process->schedState != SCHED_STATE_NONE) {
+
+		int old = process->schedState;
+		Process* last = stateMembers[old][--stateCounts[old]];
+		stateMembers[old][process->stateIndex] = last;
+		last->stateIndex = process->stateIndex;
+
+	}
+
+	if(state != SCHED_STATE_NONE && stateCounts[state] < MAX_STATE_MEMBERS) {
+		process->stateIndex = stateCounts[state];
+		stateMembers[state][stateCounts[state]++] = process;
+	} else {
+		state = SCHED_STATE_NONE;
+	}
+
+	process->schedState = state;
+
+	stateUnlock();
+
+}
+
+/**
+ * Copies the pids of a state set into a schedule print array.
+ * The caller must hold the state lock.
+ * Parameters:
+ * state: the set to copy.
+ * pids: the array to copy into.
+ * Returns the number of pids copied.
+ */
+INT16 copyStatePids(int state, INT16* pids) {
+
+	int count = stateCounts[state];
+
+	if(count > SP_MAX_NUMBER_OF_PIDS) {
+		count = SP_MAX_NUMBER_OF_PIDS;
+	}
+
+	for(int i = 0; i < count; i++) {
+		pids[i] = (INT16)stateMembers[state][i]->pid;
+	}
+
+	return (INT16)count;
+
+}
+
+/**
+ * Conducts a call to the scheduler printing
+ * mechanism. The state sets are kept up to date
+ * as processes change state, so no queue is walked.
+ * Parameters:
+ * running: the process giving up the CPU, or -1
+ * if we've come from a terminated process.
+ */
+void schedulePrint(Process* running) {
+
+	if(numSchedulePrints >= schedulePrintLimit) {
+		return;
+	}
+
+	//the state lock also keeps two processors
+	//from filling in spData at the same time.
+	stateLock();
+
+	if((int)running != -1) {
+		spData.CurrentlyRunningPID = (INT16)running->pid;
+	} else {
+		//this means that the PID doesn't exist.
+		//ie. the process was deleted.
+		spData.CurrentlyRunningPID = -1;
+	}
+
+	spData.NumberOfReadyProcesses = copyStatePids(SCHED_STATE_READY, spData.ReadyProcessPIDs);
+	spData.NumberOfTimerSuspendedProcesses = copyStatePids(SCHED_STATE_TIMER, spData.TimerSuspendedProcessPIDs);
+	spData.NumberOfProcSuspendedProcesses = copyStatePids(SCHED_STATE_SUSPENDED, spData.ProcSuspendedProcessPIDs);
+	spData.NumberOfMessageSuspendedProcesses = copyStatePids(SCHED_STATE_MESSAGE, spData.MessageSuspendedProcessPIDs);
+	spData.NumberOfDiskSuspendedProcesses = copyStatePids(SCHED_STATE_DISK, spData.DiskSuspendedProcessPIDs);
+
+	//print using the schedule printer.
+	CALL(SPPrintLine(&spData));
+
+	++numSchedulePrints;
+	stateUnlock();
+}
+
+/**
+ * Returns whether the ready queue is empty in the
+ * form of a boolean.
+ */
+int readyQueueIsEmpty() {
+
+	//other processors may be changing the queues as we look.
+	readyLock();
+	int empty = (int)QNextItemInfo(readyQueueId) == -1
+			&& (int)QNextItemInfo(edfQueueId) == -1
+			&& fairTree.count == 0;
+	readyUnlock();
+
+	return empty;
+
+}
+
+/**
+ * Keeps count of the ready processes waiting
+ * for the processor they last ran on.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the process joining or leaving the ready queue.
+ * change: 1 if it's joining, -1 if it's leaving.
+ */
+void countReadyWaiting(Process* process, int change) {
+	if(process->lastProcessor >= 0 && process->lastProcessor < MAX_NUMBER_OF_PROCESSORS) {
+		readyWaitingFor[process->lastProcessor] += change;
+	}
+}
+
+/**
+ * Adds a process to the ready queue.
+ * EDF processes go on the EDF queue, ordered
+ * by the deadline of their current job. Under the
+ * fair policy, normal processes go in the fair tree.
+ * Parameters: process: the process to be added.
+ */
+void addToReadyQueue(Process* process) {
+	//QInsertOnTail(readyQueueId, &process);
+	traceEvent(TRACE_ENQUEUE, process, 0);
+	setScheduleState(process, SCHED_STATE_READY);
+	readyLock();
+	process->readySinceDispatch = dispatchCount;
+	insertReady(process);
+	readyUnlock();
+}
+
+/**
+ * Puts a process on the ready queue its
+ * scheduling class and the policy call for.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the process to insert.
+ */
+void insertReady(Process* process) {
+	if(process->schedulingClass == SCHED_CLASS_EDF) {
+		QInsert(edfQueueId, process->absoluteDeadline, process);
+		countReadyWaiting(process, 1);
+	} else if(schedulingPolicy == SCHED_POLICY_FAIR) {
+
+		if(!process->readyNode.inTree) {
+
+			//a process that's been waiting can't bank up CPU time.
+			//otherwise it would hog the CPU once it wakes.
+			//a boosted process may start a little ahead of the rest.
+			long floor = minVruntime - process->boost * FAIR_BOOST_CREDIT;
+			if(process->vruntime < floor) {
+				process->vruntime = floor;
+			}
+
+			rbInsert(&fairTree, &process->readyNode, process->vruntime, process);
+			countReadyWaiting(process, 1);
+
+		}
+
+	} else {
+		QInsert(readyQueueId, effectivePriority(process), process);
+		countReadyWaiting(process, 1);
+	}
+}
+
+/**
+ * Moves a ready process to the place it now belongs,
+ * after something it's ordered by has changed.
+ * It was ready and stays ready, so nothing is traced.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the process to move. Ignored if it isn't ready.
+ */
+void requeueReady(Process* process) {
+	if(removeFromReadyQueue(process) != -1) {
+		insertReady(process);
+	}
+}
+
+/**
+ * Removes the process that should run next.
+ * EDF processes always run before normal ones.
+ * The caller must hold the ready lock.
+ * Returns the next process, or -1 if nothing is ready.
+ */
+Process* removeNextReady() {
+
+	Process* next = QRemoveHead(edfQueueId);
+
+	if((int)next == -1) {
+
+		RBNode* first = rbFirst(&fairTree);
+
+		if(first != NULL) {
+			next = (Process*)first->item;
+			rbRemove(&fairTree, first);
+		} else {
+			next = QRemoveHead(readyQueueId);
+		}
+
+	}
+
+	if((int)next != -1) {
+		countReadyWaiting(next, -1);
+	}
+
+	return next;
+
+}
+
+/**
+ * Removes a process from whichever ready queue it's on.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the process to remove.
+ * Returns 0 if the process was removed, -1 if it wasn't ready.
+ */
+int removeFromReadyQueue(Process* process) {
+
+	if((int)QRemoveItem(edfQueueId, process) != -1) {
+		countReadyWaiting(process, -1);
+		return 0;
+	}
+
+	if(process->readyNode.inTree) {
+		rbRemove(&fairTree, &process->readyNode);
+		countReadyWaiting(process, -1);
+		return 0;
+	}
+
+	if((int)QRemoveItem(readyQueueId, process) != -1) {
+		countReadyWaiting(process, -1);
+		return 0;
+	}
+
+	return -1;
+
+}
+
+/**
+ * Returns whether a process is on either ready queue.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the process to look for.
+ */
+int isInReadyQueue(Process* process) {
+	return (int)QItemExists(edfQueueId, process) != -1
+			|| (int)QItemExists(readyQueueId, process) != -1
+			|| process->readyNode.inTree;
+}
+
+/**
+ * Gives a newly created process its default
+ * scheduling information. Every process starts
+ * out in the normal scheduling class.
+ * Parameters:
+ * process: the process to set up.
+ */
+void initSchedulingInfo(Process* process) {
+
+	process->schedulingClass = SCHED_CLASS_NORMAL;
+	process->period = 0;
+	process->relativeDeadline = 0;
+	process->budget = 0;
+	process->releaseTime = 0;
+	process->absoluteDeadline = 0;
+	process->edfJobs = 0;
+	process->deadlineMisses = 0;
+	process->jobRuntime = 0;
+	process->budgetOverruns = 0;
+	process->vruntime = 0;
+	process->lastDispatchTime = 0;
+	process->readyNode.inTree = 0;
+	process->processorSlot = -1;
+	process->lastProcessor = -1;
+	process->readySinceDispatch = 0;
+	process->boost = 0;
+	process->boostRuntime = 0;
+	process->groupId = 0;
+	process->schedState = SCHED_STATE_NONE;
+	process->stateIndex = -1;
+	process->inheritedPriority = -1;
+	process->waitingOnInterlock = -1;
+	process->terminatePending = 0;
+
+}
+
+/**
+ * Starts a walk over the ready processes,
+ * in the order they'd be dispatched.
+ * The caller must hold the ready lock for the whole walk.
+ * Parameters:
+ * cursor: the walk to start.
+ */
+void readyCursorStart(ReadyCursor* cursor) {
+	cursor->stage = 0;
+	cursor->index = 0;
+	cursor->node = NULL;
+}
+
+/**
+ * Moves a walk over the ready processes on by one.
+ * Nothing may be made ready or taken off the ready
+ * processes while the walk goes on.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * cursor: the walk, from readyCursorStart.
+ * Returns the next process, or -1 once they've all been seen.
+ */
+Process* readyCursorNext(ReadyCursor* cursor) {
+
+	Process* proc;
+
+	if(cursor->stage == 0) {
+
+		proc = (Process*)QWalk(edfQueueId, cursor->index);
+
+		if((int)proc != -1) {
+			++cursor->index;
+			return proc;
+		}
+
+		cursor->stage = 1;
+		cursor->node = rbFirst(&fairTree);
+
+	}
+
+	if(cursor->stage == 1) {
+
+		if(cursor->node != NULL) {
+			proc = (Process*)cursor->node->item;
+			cursor->node = rbNext(cursor->node);
+			return proc;
+		}
+
+		cursor->stage = 2;
+		cursor->index = 0;
+
+	}
+
+	proc = (Process*)QWalk(readyQueueId, cursor->index);
+
+	if((int)proc != -1) {
+		++cursor->index;
+	}
+
+	return proc;
+
+}
+
+/**
+ * Returns how many ready processes last ran on a given processor.
+ * The caller must hold the ready lock.
+ */
+int readyPreferring(int processor) {
+	return readyWaitingFor[processor];
+}
+
+/**
+ * Chooses which free processor a ready process should start on.
+ * A process goes back to the processor it last ran on if that's free.
+ * If it isn't, the process waits for it unless the processor is
+ * overloaded compared to a free one, or the process has waited too long.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the ready process to place.
+ * Returns the processor to use, or -1 if the process should keep waiting.
+ */
+int chooseProcessor(Process* process) {
+
+	//a process can be woken before it's finished suspending.
+	//it still has its processor, so it keeps it.
+	if(process->processorSlot != -1) {
+		return process->processorSlot;
+	}
+
+	int preferred = process->lastProcessor;
+
+	if(preferred != -1 && runningOn[preferred] == NULL) {
+		return preferred;
+	}
+
+	//find the free processor the fewest ready processes are waiting for.
+	int best = -1;
+	int bestWaiting = 0;
+
+	for(int i = 0; i < numProcessors && i < MAX_NUMBER_OF_PROCESSORS; i++) {
+
+		if(runningOn[i] == NULL) {
+
+			int waiting = readyPreferring(i);
+
+			if(best == -1 || waiting < bestWaiting) {
+				best = i;
+				bestWaiting = waiting;
+			}
+
+		}
+
+	}
+
+	//a new process has nowhere to go back to.
+	if(preferred == -1 || best == -1) {
+		return best;
+	}
+
+	//every start since it became ready passed it over.
+	if(dispatchCount - process->readySinceDispatch >= AFFINITY_AGING_LIMIT
+			|| readyPreferring(preferred) - bestWaiting >= MIGRATION_THRESHOLD) {
+		return best;
+	}
+
+	return -1;
+
+}
+
+/**
+ * Puts a process on a free processor.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the process about to be started.
+ * processor: the free processor to start it on.
+ * Returns the processor the process is running on.
+ */
+int claimProcessor(Process* process, int processor) {
+
+	//a process can be woken before it's finished suspending.
+	//it still has its processor, so it keeps it.
+	if(process->processorSlot != -1) {
+		return process->processorSlot;
+	}
+
+	runningOn[processor] = process;
+	process->processorSlot = processor;
+	process->lastProcessor = processor;
+	++dispatchCount;
+
+	return processor;
+
+}
+
+/**
+ * Hands the CPU straight to a process that was just woken,
+ * skipping the ready queue. The current process goes back
+ * on the ready queue. A process replying to a message then
+ * runs without waiting behind everything else that's ready.
+ * On a multiprocessor, or if it would let a normal process
+ * run ahead of an EDF one, the woken process is just made ready.
+ * Parameters:
+ * target: the woken process. It must not be on any queue.
+ */
+void switchTo(Process* target) {
+
+	Process* current = currentProcess();
+
+	//EDF processes, running or ready, always come before a normal target.
+	int edfWaiting = (int)current != -1
+			&& (current->schedulingClass == SCHED_CLASS_EDF
+					|| (int)QNextItemInfo(edfQueueId) != -1);
+
+	if(numProcessors > 1 || (int)current == -1
+			|| (target->schedulingClass != SCHED_CLASS_EDF && edfWaiting)) {
+		addToReadyQueue(target);
+		return;
+	}
+
+	chargeRuntime(current);
+	traceEvent(TRACE_PREEMPT, current, target->pid);
+	addToReadyQueue(current);
+	markDispatched(target);
+
+	MEMORY_MAPPED_IO mmio;
+	mmio.Mode = Z502StartContext;
+	mmio.Field1 = target->contextId;
+	mmio.Field2 = START_NEW_CONTEXT_AND_SUSPEND;
+	mmio.Field3 = 0;
+	mmio.Field4 = 0;
+
+	MEM_WRITE(Z502Context, &mmio);
+
+	//if there was an error, stop.
+	if(mmio.Field4 == ERR_BAD_PARAM) {
+		aprintf("Error handing off to process %ld.\n", target->pid);
+		exit(0);
+	}
+
+}
+
+/**
+ * Gives a process the wakeup boost for its scheduling class.
+ * Used when a process stops waiting on a disk or a message.
+ * Boosts don't stack. A process woken again just gets a full boost.
+ * Parameters:
+ * process: the process being woken.
+ */
+void applyWakeupBoost(Process* process) {
+
+	process->boost = wakeupBoost[process->schedulingClass];
+	process->boostRuntime = 0;
+
+}
+
+/**
+ * Takes a level off a process's boost for each
+ * BOOST_DECAY_TIME of CPU time it has run since it last lost one.
+ * Parameters:
+ * process: the process whose boost is wearing off.
+ * ran: the CPU time the process just used.
+ */
+void decayBoost(Process* process, long ran) {
+
+	if(process->boost == 0) {
+		return;
+	}
+
+	process->boostRuntime += ran;
+
+	while(process->boost > 0 && process->boostRuntime >= BOOST_DECAY_TIME) {
+		--process->boost;
+		process->boostRuntime -= BOOST_DECAY_TIME;
+	}
+
+}
+
+/**
+ * Makes a process ready after a disk or message wait,
+ * giving it a wakeup boost.
+ * Parameters:
+ * process: the process being woken.
+ */
+void wakeProcess(Process* process) {
+
+	applyWakeupBoost(process);
+	addToReadyQueue(process);
+
+}
+
+/**
+ * Returns the priority a process is queued at under
+ * the priority policy: its own priority, less any boost,
+ * or the priority it inherited if that's more urgent.
+ */
+long effectivePriority(Process* process) {
+
+	long priority = process->priority - process->boost;
+
+	if(priority < 0) {
+		priority = 0;
+	}
+
+	if(process->inheritedPriority != -1 && process->inheritedPriority < priority) {
+		priority = process->inheritedPriority;
+	}
+
+	return priority;
+
+}
+
+/**
+ * Records that a process has just been given the CPU.
+ * Parameters:
+ * process: the process being started.
+ */
+void markDispatched(Process* process) {
+
+	process->lastDispatchTime = getTimeOfDay();
+	traceEvent(TRACE_DISPATCH, process, 0);
+	setScheduleState(process, SCHED_STATE_NONE);
+
+	//the fair policy's floor only ever moves forward.
+	if(schedulingPolicy == SCHED_POLICY_FAIR && process->vruntime > minVruntime) {
+		minVruntime = process->vruntime;
+	}
+
+}
+
+/**
+ * Frees the processor a process was running on.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the process giving up its processor.
+ */
+void releaseProcessor(Process* process) {
+
+	if(process->processorSlot != -1) {
+		runningOn[process->processorSlot] = NULL;
+		process->processorSlot = -1;
+	}
+
+}
+
+/**
+ * Returns how many processors have nothing running on them.
+ */
+int freeProcessors() {
+
+	readyLock();
+	int count = countFreeProcessors();
+	readyUnlock();
+
+	return count;
+
+}
+
+/**
+ * Returns how many processors have nothing running on them.
+ * The caller must hold the ready lock.
+ */
+int countFreeProcessors() {
+
+	int count = 0;
+
+	for(int i = 0; i < numProcessors && i < MAX_NUMBER_OF_PROCESSORS; i++) {
+		if(runningOn[i] == NULL) {
+			++count;
+		}
+	}
+
+	return count;
+
+}
+
+/**
+ * Takes a ready process off the ready queue
+ * and starts it on a processor in M mode.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the ready process to start.
+ * processor: the free processor to start it on.
+ */
+void startOnProcessor(Process* process, int processor) {
+
+	removeFromReadyQueue(process);
+	processor = claimProcessor(process, processor);
+	markDispatched(process);
+
+	MEMORY_MAPPED_IO mmio;
+	mmio.Mode = Z502StartContext;
+	mmio.Field1 = process->contextId;
+	mmio.Field2 = START_NEW_CONTEXT_ONLY;
+	mmio.Field3 = processor;
+	mmio.Field4 = 0;
+
+	MEM_WRITE(Z502Context, &mmio);
+
+	if(mmio.Field4 != ERR_SUCCESS) {
+		aprintf("Multidispatcher could not start process.\n");
+		exit(0);
+	}
+
+}
+
+/**
+ * Starts every ready member of a process group at once,
+ * so members that wait on each other run side by side.
+ * Nothing is started unless every member gets a processor.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * groupId: the group to start.
+ * Returns the number of members started, 0 if they don't
+ * all fit yet, or -1 if there are more of them than processors.
+ */
+int startGang(long groupId) {
+
+	Process* members[MAX_NUMBER_OF_PROCESSORS];
+	int placedOn[MAX_NUMBER_OF_PROCESSORS];
+	int taken[MAX_NUMBER_OF_PROCESSORS];
+	int count = 0;
+
+	for(int p = 0; p < MAX_NUMBER_OF_PROCESSORS; p++) {
+		taken[p] = p >= numProcessors || runningOn[p] != NULL;
+	}
+
+	//gather the ready members.
+	ReadyCursor cursor;
+	readyCursorStart(&cursor);
+	Process* proc = readyCursorNext(&cursor);
+
+	while((int)proc != -1) {
+
+		if(proc->groupId == groupId) {
+
+			if(count == numProcessors || count == MAX_NUMBER_OF_PROCESSORS) {
+				return -1;
+			}
+
+			members[count++] = proc;
+
+		}
+
+		proc = readyCursorNext(&cursor);
+
+	}
+
+	//give each member a processor before starting any of them.
+	//members go back to their last processor if they can.
+	for(int m = 0; m < count; m++) {
+
+		proc = members[m];
+		int processor = proc->processorSlot;
+
+		if(processor == -1 && proc->lastProcessor != -1 && !taken[proc->lastProcessor]) {
+			processor = proc->lastProcessor;
+		}
+
+		for(int p = 0; processor == -1 && p < numProcessors && p < MAX_NUMBER_OF_PROCESSORS; p++) {
+			if(!taken[p]) {
+				processor = p;
+			}
+		}
+
+		if(processor == -1) {
+			return 0;
+		}
+
+		taken[processor] = 1;
+		placedOn[m] = processor;
+
+	}
+
+	for(int m = 0; m < count; m++) {
+		startOnProcessor(members[m], placedOn[m]);
+	}
+
+	gangHeldFor = 0;
+	return count;
+
+}
+
+/**
+ * Says whether the free processors have been held
+ * long enough for a group that doesn't fit yet.
+ * The hold starts the first time a group is asked about.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * groupId: the group the processors are being held for.
+ * Returns true once the hold has lasted GANG_HOLD_TIME.
+ */
+int gangHoldExpired(long groupId) {
+
+	long now = getTimeOfDay();
+
+	if(gangHeldFor != groupId) {
+		gangHeldFor = groupId;
+		gangHeldSince = now;
+		return 0;
+	}
 
-int numSchedulePrints = 0;
+	return now - gangHeldSince >= GANG_HOLD_TIME;
 
-/**
- * Sets up the ready queue for use.
- */
-void initReadyQueue() {
-	readyQueueId = QCreate("readyQueue");
 }
 
 /**
- * Sets up the suspend queue for use.
+ * Charges a process for the CPU time it has used
+ * since it was last dispatched. Virtual runtime grows
+ * more slowly for processes with a better (lower) priority,
+ * so they get a larger share of the CPU under the fair policy.
+ * Parameters:
+ * process: the process giving up the CPU.
  */
-void initSuspendQueue() {
-	suspendQueueId = QCreate("susQueue");
+void chargeRuntime(Process* process) {
+
+	long now = getTimeOfDay();
+	long ran = now - process->lastDispatchTime;
+
+	if(ran > 0) {
+		long weight = FAIR_BASE_WEIGHT * (FAIR_BASE_PRIORITY + 1) / (process->priority + 1);
+		if(weight < 1) {
+			weight = 1;
+		}
+		process->vruntime += ran * FAIR_BASE_WEIGHT / weight;
+
+		decayBoost(process, ran);
+
+		//an EDF job that has used up its budget is postponed a
+		//period with a fresh budget, so it can never take more of
+		//the CPU than it was admitted with.
+		if(process->schedulingClass == SCHED_CLASS_EDF) {
+
+			process->jobRuntime += ran;
+
+			if(process->jobRuntime > process->budget) {
+
+				while(process->jobRuntime > process->budget) {
+					process->jobRuntime -= process->budget;
+					process->releaseTime += process->period;
+					process->absoluteDeadline += process->period;
+					++process->budgetOverruns;
+				}
+
+				readyLock();
+				requeueReady(process);
+				readyUnlock();
+
+			}
+
+		}
+	}
+
+	process->lastDispatchTime = now;
+
 }
 
 /**
- * The following code plays the role of the scheduler
- * in a uniprocessor operating system.
- * It either starts the next ready process
- * with the greatest priority or waits if there
- * are no ready processes.
+ * Holds the current process to its EDF budget. The OS only
+ * gets control at system calls, so this is called at each one.
+ * A job that has overrun its budget is postponed, and on a
+ * uniprocessor it gives up the CPU if another EDF job's
+ * deadline is now earlier.
+ * Parameters:
+ * process: the process making a system call.
  */
-void dispatch() {
-
+void enforceEdfBudget(Process* process) {
 
-	if(numProcessors > 1) {
-		multiDispatch();
+	if((int)process == -1 || process->schedulingClass != SCHED_CLASS_EDF) {
 		return;
 	}
 
-	//pass time if there are no ready processes.
-	while(readyQueueIsEmpty()) {
-		CALL();
-	}
+	long overruns = process->budgetOverruns;
+	chargeRuntime(process);
 
-	schedulePrint();
+	if(process->budgetOverruns == overruns || numProcessors > 1) {
+		return;
+	}
 
-	//if we reach here, there is a ready process.
-	//get next process off of queue and start it.
+	//once we let go of the lock, next may be dispatched or
+	//terminated, so take what we need from it while we hold it.
 	readyLock();
-	Process* nextProcess = QRemoveHead(readyQueueId);
+	Process* next = (Process*)QNextItemInfo(edfQueueId);
+	int preempt = (int)next != -1 && next->absoluteDeadline < process->absoluteDeadline;
+	long nextPid = preempt ? next->pid : -1;
 	readyUnlock();
 
-	MEMORY_MAPPED_IO mmio;
-	mmio.Mode = Z502StartContext;
-	mmio.Field1 = nextProcess->contextId;
-	mmio.Field2 = START_NEW_CONTEXT_AND_SUSPEND;
-	mmio.Field3 = 0;
-	mmio.Field4 = 0;
-
-	MEM_WRITE(Z502Context, &mmio);
-
-	//if there was an error, stop.
-	if(mmio.Field4 == ERR_BAD_PARAM) {
-		aprintf("Error starting another process from dispatch.\n");
-		exit(0);
+	if(preempt) {
+		traceEvent(TRACE_PREEMPT, process, nextPid);
+		addToReadyQueue(process);
+		dispatch();
 	}
 
 }
 
 /**
- * Carries out multiprocessing dispatching
- * for this current process. It should suspend
- * until the dispatching process wakes it up,
- * then schedule print.
+ * Makes the current process share the CPU under the fair policy.
+ * Once it has run for FAIR_TIME_SLICE, it gives up the CPU if a
+ * ready process has less virtual runtime. Otherwise a process that
+ * never waits would keep the CPU, whatever its weight. The OS only
+ * gets control at system calls, so this is called at each one.
+ * Only a uniprocessor is held to this.
+ * Parameters:
+ * process: the process making a system call.
  */
-void multiDispatch() {
+void enforceFairShare(Process* process) {
 
-	//suspend this current one.
-	MEMORY_MAPPED_IO mmio;
-	mmio.Mode = Z502StartContext;
-	mmio.Field1 = 0;
-	mmio.Field2 = SUSPEND_CURRENT_CONTEXT_ONLY;
-	mmio.Field3 = 0;
-	mmio.Field4 = 0;
+	if(schedulingPolicy != SCHED_POLICY_FAIR || numProcessors > 1 || (int)process == -1
+			|| process->schedulingClass != SCHED_CLASS_NORMAL) {
+		return;
+	}
 
-	//if((int)currentProcess() != -1)
-	//aprintf("Process %d about to dispatch suspend\n", currentProcess()->pid);
-	MEM_WRITE(Z502Context, &mmio);
+	if(getTimeOfDay() - process->lastDispatchTime < FAIR_TIME_SLICE) {
+		return;
+	}
+
+	chargeRuntime(process);
+
+	//once we let go of the lock, next may be dispatched or
+	//terminated, so take what we need from it while we hold it.
+	readyLock();
+	RBNode* first = rbFirst(&fairTree);
+	int preempt = first != NULL && ((Process*)first->item)->vruntime < process->vruntime;
+	long nextPid = preempt ? ((Process*)first->item)->pid : -1;
+	readyUnlock();
+
+	if(preempt) {
+		traceEvent(TRACE_PREEMPT, process, nextPid);
+		addToReadyQueue(process);
+		dispatch();
+	}
 
-	schedulePrint();
 }
 
 /**
- * The code required to make the multidispatcher
- * start running.
+ * Returns the share of the CPU an EDF process
+ * may need: its budget over its relative deadline.
+ * Relative deadlines are never longer than periods,
+ * so this is a safe bound for admission control.
  */
-void startMultidispatcher() {
-	SYSTEM_CALL_DATA *SystemCallData =
-		 (SYSTEM_CALL_DATA *)calloc(1, sizeof (SYSTEM_CALL_DATA));
-	SystemCallData->NumberOfArguments = -1;
-	SystemCallData->SystemCallNumber = SYSNUM_MULTIDISPATCH;
-	ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );
-	SoftwareTrap(SystemCallData);
-	free(SystemCallData);
-
+double edfDensity(Process* process) {
+	return (double)process->budget / (double)process->relativeDeadline;
 }
 
 /**
- * This following code plays the role of the
- * scheduler in a multiprocessor system.
- * It starts all processes found in the ready
- * queue then checks whether the current process
- * can continue.
+ * Moves a process into or out of the EDF scheduling class.
+ * A process is only admitted if the total density of all
+ * EDF processes stays within EDF_UTILISATION_BOUND.
+ * Parameters:
+ * pid: the process to change. -1 means this process.
+ * period: how often a new job is released. 0 returns the
+ * process to the normal class.
+ * relativeDeadline: how long after release each job must finish.
+ * budget: how much execution time each job needs.
+ * Returns 0 if successful or -1 if an error occurs or the
+ * process couldn't be admitted.
  */
-void multidispatcher() {
+long setDeadline(long pid, long period, long relativeDeadline, long budget) {
 
-	while(1) {
-
-		if(!readyQueueIsEmpty()) {
+	Process* process;
 
-			while(!readyQueueIsEmpty()) {
+	if(pid == -1) {
+		process = currentProcess();
+	} else {
+		process = getProcess(pid);
+	}
 
-				readyLock();
-				Process* proc = QRemoveHead(readyQueueId);
+	if((int)process == -1) {
+		return -1;
+	}
 
-				MEMORY_MAPPED_IO mmio;
-				mmio.Mode = Z502StartContext;
-				mmio.Field1 = proc->contextId;
-				mmio.Field2 = START_NEW_CONTEXT_ONLY;
-				mmio.Field3 = 0;
-				mmio.Field4 = 0;
+	//leaving the EDF class.
+	if(period == 0) {
 
-				MEM_WRITE(Z502Context, &mmio);
+		readyLock();
+		if(process->schedulingClass == SCHED_CLASS_EDF) {
 
-				readyUnlock();
+			edfUtilisation -= edfDensity(process);
 
-				if(mmio.Field4 != ERR_SUCCESS) {
-					aprintf("Multidispatcher could not start process.\n");
-					exit(0);
-				}
+			int wasReady = removeFromReadyQueue(process) != -1;
+			process->schedulingClass = SCHED_CLASS_NORMAL;
 
+			if(wasReady) {
+				insertReady(process);
 			}
 
-		} else {
-
-			CALL();
-
 		}
+		readyUnlock();
+		return 0;
 
 	}
 
-}
+	//deadlines must fit in the period, and a job must fit before its deadline.
+	if(period < 0 || relativeDeadline <= 0 || relativeDeadline > period
+			|| budget <= 0 || budget > relativeDeadline) {
+		return -1;
+	}
 
-/**
- * Conducts a call to the scheduler printing
- * mechanism.
- * Notes: if we've come from a terminated process,
- * the currently running PID is shown as -1.
- */
-void schedulePrint() {
+	double newDensity = (double)budget / (double)relativeDeadline;
 
-	if(numSchedulePrints >= schedulePrintLimit) {
-		return;
+	//time this process has already run is charged to it as it was,
+	//so the first job starts with its whole budget.
+	if(process == currentProcess()) {
+		chargeRuntime(process);
 	}
 
-	SP_INPUT_DATA* spData = malloc(sizeof(SP_INPUT_DATA));
-	strcpy(spData->TargetAction, "Dispatch");
+	readyLock();
 
-	if((int)currentProcess() != -1) {
-		spData->CurrentlyRunningPID = (INT16)(currentProcess()->pid);
-	} else {
-		//this means that the PID doesn't exist.
-		//ie. the process was deleted.
-		spData->CurrentlyRunningPID = -1;
+	double oldDensity = 0;
+
+	if(process->schedulingClass == SCHED_CLASS_EDF) {
+		oldDensity = edfDensity(process);
+	}
+
+	//admission control.
+	if(edfUtilisation - oldDensity + newDensity > EDF_UTILISATION_BOUND) {
+		readyUnlock();
+		return -1;
 	}
 
-	spData->NumberOfDiskSuspendedProcesses = 0;
-	spData->NumberOfMessageSuspendedProcesses = 0;
-	spData->NumberOfProcSuspendedProcesses = 0;
-	spData->NumberOfReadyProcesses = 0;
-	spData->NumberOfRunningProcesses = 0;
-	spData->NumberOfTerminatedProcesses = 0;
-	spData->NumberOfTimerSuspendedProcesses = 0;
+	edfUtilisation += newDensity - oldDensity;
+	edfUsed = 1;
 
-	//give all arrays default values
-	for(int i = 0; i<SP_MAX_NUMBER_OF_PIDS; i++) {
+	//the process must be requeued since its class or deadline changes.
+	int wasReady = removeFromReadyQueue(process) != -1;
 
-		spData->DiskSuspendedProcessPIDs[i] = 0;
-		spData->MessageSuspendedProcessPIDs[i] = 0;
-		spData->ProcSuspendedProcessPIDs[i] = 0;
-		spData->ReadyProcessPIDs[i] = 0;
-		spData->RunningProcessPIDs[i] = 0;
-		spData->TerminatedProcessPIDs[i] = 0;
-		spData->TimerSuspendedProcessPIDs[i] = 0;
+	process->schedulingClass = SCHED_CLASS_EDF;
+	process->period = period;
+	process->relativeDeadline = relativeDeadline;
+	process->budget = budget;
+	process->releaseTime = getTimeOfDay();
+	process->absoluteDeadline = process->releaseTime + relativeDeadline;
+	process->jobRuntime = 0;
 
+	if(wasReady) {
+		insertReady(process);
 	}
 
-	int i = 0;
-	Process* currReady = (Process*)QWalk(readyQueueId,i);
-	spData->NumberOfReadyProcesses = 0;
-
-	//count the # of ready processes, store their pids.
-	while((int)currReady != -1) {
+	readyUnlock();
+	return 0;
 
-		++spData->NumberOfReadyProcesses;
-		spData->ReadyProcessPIDs[i] = (INT16)currReady->pid;
+}
 
-		++i;
-		currReady = (Process*)QWalk(readyQueueId,i);
+/**
+ * Marks the current job of an EDF process as finished,
+ * counting a miss if it finished after its deadline, and
+ * releases the process's next job. A real-time process
+ * finishes a job by sleeping until its next period.
+ * Parameters:
+ * process: the process finishing its job.
+ */
+void completeEdfJob(Process* process) {
 
+	if(process->schedulingClass != SCHED_CLASS_EDF) {
+		return;
 	}
 
-	//count the # of timer suspended processes, store their pids.
-	i = 0;
-	TimerRequest* currTimer = (TimerRequest*)QWalk(timerQueueID,i);
-	spData->NumberOfTimerSuspendedProcesses = 0;
+	long now = getTimeOfDay();
 
-	while((int)currTimer != -1) {
+	++process->edfJobs;
 
-		++spData->NumberOfTimerSuspendedProcesses;
-		spData->TimerSuspendedProcessPIDs[i] = (INT16)currTimer->process->pid;
+	if(now > process->absoluteDeadline) {
+		++process->deadlineMisses;
+	}
 
-		++i;
-		currTimer = (TimerRequest*)QWalk(timerQueueID, i);
+	//the next job is released one period after this one.
+	//if we're so late that job is already overdue, release it now.
+	process->releaseTime += process->period;
 
+	if(process->releaseTime + process->relativeDeadline < now) {
+		process->releaseTime = now;
 	}
 
-	//count the # of suspended processes, store their pids.
-	i = 0;
-	Process* currSuspend = (Process*)QWalk(suspendQueueId, i);
-	spData->NumberOfProcSuspendedProcesses = 0;
+	process->absoluteDeadline = process->releaseTime + process->relativeDeadline;
+	process->jobRuntime = 0;
 
-	while((int)currSuspend != -1) {
-
-		++spData->NumberOfProcSuspendedProcesses;
-		spData->ProcSuspendedProcessPIDs[i] = (INT16)currSuspend->pid;
+}
 
-		++i;
-		currSuspend = (Process*)QWalk(suspendQueueId, i);
+/**
+ * Prints how many jobs each EDF process has
+ * completed and how many deadlines were missed.
+ * Nothing is printed if EDF was never used.
+ */
+void printEdfReport() {
 
+	if(!edfUsed) {
+		return;
 	}
 
-	//count msg suspended process, store their pids.
-	i = 0;
-	Process* currMsg = (Process*)QWalk(msgSuspendQueueID, i);
-	spData->NumberOfMessageSuspendedProcesses = 0;
+	long totalJobs = retiredEdfJobs;
+	long totalMisses = retiredDeadlineMisses;
+	long totalOverruns = retiredBudgetOverruns;
 
-	while((int)currMsg != -1) {
+	aprintf("EDF Statistics:\n");
 
-		++spData->NumberOfMessageSuspendedProcesses;
-		spData->MessageSuspendedProcessPIDs[i] = (INT16)currMsg->pid;
+	processReadLock();
+	int i = 0;
+	Process* proc = (Process*)QWalk(processQueueID, i);
 
-		++i;
-		currMsg = (Process*)QWalk(msgSuspendQueueID, i);
+	while((int)proc != -1) {
 
-	}
+		if(proc->schedulingClass == SCHED_CLASS_EDF) {
 
-	//count disk suspended processes, store their pids.
-	i = 0;
-	DiskRequest* currDisk = (DiskRequest*)QWalk(diskQueueId, i);
-	spData->NumberOfDiskSuspendedProcesses = 0;
+			aprintf("PID %ld: Period = %ld, Deadline = %ld, Budget = %ld, Jobs = %ld, Deadline Misses = %ld, Budget Overruns = %ld\n",
+					proc->pid, proc->period, proc->relativeDeadline, proc->budget,
+					proc->edfJobs, proc->deadlineMisses, proc->budgetOverruns);
 
-	while((int)currDisk != -1) {
+		}
 
-		++spData->NumberOfDiskSuspendedProcesses;
-		spData->DiskSuspendedProcessPIDs[i] = (INT16)currDisk->process->pid;
+		totalJobs += proc->edfJobs;
+		totalMisses += proc->deadlineMisses;
+		totalOverruns += proc->budgetOverruns;
 
 		++i;
-		currDisk = (DiskRequest*)QWalk(diskQueueId, i);
+		proc = (Process*)QWalk(processQueueID, i);
 
 	}
+	processReadUnlock();
 
-	//print using the schedule printer.
-	CALL(SPPrintLine(spData));
-
-	//prevent memory leak.
-	free(spData);
-	++numSchedulePrints;
-}
-
-/**
- * Returns whether the ready queue is empty in the
- * form of a boolean.
- */
-int readyQueueIsEmpty() {
-	return (int)QNextItemInfo(readyQueueId) == -1;
-}
+	aprintf("Total EDF Jobs = %ld, Total Deadline Misses = %ld, Total Budget Overruns = %ld, Utilisation = %5.3f\n",
+			totalJobs, totalMisses, totalOverruns, edfUtilisation);
 
-/**
- * Adds a process to the ready queue.
- * Parameters: process: the process to be added.
- */
-void addToReadyQueue(Process* process) {
-	//QInsertOnTail(readyQueueId, &process);
-	readyLock();
-	QInsert(readyQueueId, process->priority, process);
-	readyUnlock();
 }
 
 /**
@@ -330,33 +1411,44 @@ long terminateProcess(long pid) {
 		//shut down the current process.
 		//remove it from ready queue and process queue.
 		Process* current = currentProcess();
+		traceEvent(TRACE_TERMINATE, current, 0);
+		setScheduleState(current, SCHED_STATE_NONE);
 		readyLock();
-		QRemoveItem(readyQueueId,current);
+		removeFromReadyQueue(current);
+		retireEdfProcess(current);
+		releaseProcessor(current);
 		readyUnlock();
 
 		processLock();
 		QRemoveItem(processQueueID,current);
 		processUnlock();
 
+		//one that was terminated while it ran may
+		//have started waiting before it found out.
+		leaveWaits(current);
+		releaseInterlocks(current);
+
 		processLock();
 		--numProcesses;
 		processUnlock();
 
 		//if there are no remaining processes, shut down.
 		if(numProcesses == 0) {
-			MEM_WRITE(Z502Halt, 0);
+			haltOS();
 		}
 
 		//we just terminated ourselves.
 		//so, we don't return.
 		//instead, we start another process.
+		//our context is destroyed once we've left it.
+		retireContext(current);
 		dispatch();
 		return 0;
 
 	} else if(pid == -2) {
 
 		//terminate the current process and all children.
-		MEM_WRITE(Z502Halt, 0);
+		haltOS();
 		return 0;
 	} else {
 		//terminate the process with the given pid.
@@ -368,6 +1460,23 @@ long terminateProcess(long pid) {
 			return -1;
 		}
 
+		if(process == currentProcess()) {
+			return terminateProcess(-1);
+		}
+
+		//a process running on another processor can't be taken
+		//apart under it. it ends itself the next time it traps.
+		readyLock();
+
+		if(process->processorSlot != -1) {
+			process->terminatePending = 1;
+			readyUnlock();
+			return 0;
+		}
+
+		removeFromReadyQueue(process);
+		readyUnlock();
+
 		processLock();
 		int processResult = (int)QRemoveItem(processQueueID,process);
 		processUnlock();
@@ -378,17 +1487,18 @@ long terminateProcess(long pid) {
 
 		} else {
 			//we successfully found it. remove it from all queues.
+			traceEvent(TRACE_TERMINATE, process, 0);
+			setScheduleState(process, SCHED_STATE_NONE);
+			leaveWaits(process);
+
+			//a wakeup may have slipped in before it left its waits.
 			readyLock();
-			QRemoveItem(readyQueueId,process);
+			removeFromReadyQueue(process);
+			retireEdfProcess(process);
 			readyUnlock();
 
-			timerLock();
-			QRemoveItem(timerQueueID, process);
-			timerUnlock();
-
-			suspendLock();
-			QRemoveItem(suspendQueueId, process);
-			suspendUnlock();
+			releaseInterlocks(process);
+			retireContext(process);
 
 			processLock();
 			--numProcesses;
@@ -400,6 +1510,32 @@ long terminateProcess(long pid) {
 
 }
 
+/**
+ * Takes a terminated process off everything it may
+ * be waiting on, so nothing wakes it again.
+ * Parameters:
+ * process: the terminated process.
+ */
+void leaveWaits(Process* process) {
+
+	timerLock();
+	removeTimerRequest(process);
+	timerUnlock();
+
+	suspendLock();
+	QRemoveItem(suspendQueueId, process);
+	suspendUnlock();
+
+	msgSuspendLock();
+	if((int)QItemExists(msgSuspendQueueID, process) != -1) {
+		QRemoveItem(msgSuspendQueueID, process);
+	}
+	msgSuspendUnlock();
+
+	abandonDiskWait(process);
+
+}
+
 /**
  * Determines whether a process with
  * a given pid can be found in the
@@ -412,26 +1548,89 @@ long terminateProcess(long pid) {
 int inReadyQueue(long pid) {
 
 	readyLock();
-	int i = 0;
-	Process* curr = QWalk(readyQueueId, i);
+	Process* curr = findReady(pid);
+	readyUnlock();
 
-	//iterate through the queue until
-	//we find the pid.
-	while((int)curr != -1) {
+	if((int)curr != -1) {
+		return 1;
+	}
+
+	//we didn't find it. return false.
+	return 0;
+
+}
+
+/**
+ * Finds the process with a given pid
+ * on either ready queue.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * pid: the pid of the process to find.
+ * Returns the process, or -1 if it isn't ready.
+ */
+Process* findReady(long pid) {
+
+	int queues[2] = {edfQueueId, readyQueueId};
+
+	for(int q = 0; q < 2; ++q) {
+
+		int i = 0;
+		Process* curr = (Process*)QWalk(queues[q], i);
+
+		//iterate through the queue until
+		//we find the pid.
+		while((int)curr != -1) {
+
+			if(curr->pid == pid) {
+				return curr;
+			}
+
+			++i;
+			curr = (Process*)QWalk(queues[q], i);
 
-		if(curr->pid == pid) {
-			readyUnlock();
-			return 1;
 		}
 
-		++i;
-		curr = QWalk(readyQueueId, i);
+	}
+
+	RBNode* node = rbFirst(&fairTree);
+
+	while(node != NULL) {
+
+		if(((Process*)node->item)->pid == pid) {
+			return (Process*)node->item;
+		}
+
+		node = rbNext(node);
 
 	}
-	readyUnlock();
 
-	//we didn't find it. return false.
-	return 0;
+	return (Process*)-1;
+
+}
+
+/**
+ * Takes a terminating process out of the EDF class.
+ * Its share of the CPU is given back and its job
+ * counts are kept for the end of run report.
+ * The caller must hold the ready lock.
+ * Parameters:
+ * process: the terminating process.
+ */
+void retireEdfProcess(Process* process) {
+
+	if(process->schedulingClass != SCHED_CLASS_EDF) {
+		return;
+	}
+
+	edfUtilisation -= edfDensity(process);
+	retiredEdfJobs += process->edfJobs;
+	retiredDeadlineMisses += process->deadlineMisses;
+	retiredBudgetOverruns += process->budgetOverruns;
+
+	process->schedulingClass = SCHED_CLASS_NORMAL;
+	process->edfJobs = 0;
+	process->deadlineMisses = 0;
+	process->budgetOverruns = 0;
 
 }
 
@@ -496,23 +1695,18 @@ long suspendProcess(long pid) {
 	}
 
 	readyLock();
-	int i = 0;
-	Process* curr = (Process*)QWalk(readyQueueId, i);
-
-	//iterate until we find the pid we're looking for.
-	while(curr->pid != pid) {
-		++i;
-		curr = (Process*)QWalk(readyQueueId, i);
-	}
+	Process* curr = findReady(pid);
 	readyUnlock();
 
 	//remove from ready queue, then add to suspend queue.
 	readyLock();
-	QRemoveItem(readyQueueId,curr);
+	removeFromReadyQueue(curr);
 	readyUnlock();
 
 	suspendLock();
 	QInsertOnTail(suspendQueueId,curr);
+	traceEvent(TRACE_BLOCK, curr, TRACE_REASON_SUSPEND);
+	setScheduleState(curr, SCHED_STATE_SUSPENDED);
 	suspendUnlock();
 
 	return 0;
@@ -563,6 +1757,7 @@ long resumeProcess(long pid) {
 	QRemoveItem(suspendQueueId, curr);
 	suspendUnlock();
 
+	traceEvent(TRACE_WAKE, curr, TRACE_REASON_SUSPEND);
 	addToReadyQueue(curr);
 
 	return 0;
@@ -10,19 +10,120 @@
 
 #include "moreGlobals.h"
 
+#define SCHED_CLASS_NORMAL 0
+#define SCHED_CLASS_EDF 1
+
+//the total EDF density we allow before rejecting
+//new real-time processes.
+#define EDF_UTILISATION_BOUND 1.0
+
+//policies for ordering normal processes.
+//priority runs the highest priority process first.
+//fair runs the process with the least virtual runtime first.
+#define SCHED_POLICY_PRIORITY 0
+#define SCHED_POLICY_FAIR 1
+
+//under the fair policy, a process with this priority
+//accrues virtual runtime at the same rate as real time.
+#define FAIR_BASE_PRIORITY 10
+#define FAIR_BASE_WEIGHT 1024
+
+//under the fair policy, how long a process runs before it
+//gives up the CPU to a ready process with less virtual runtime.
+#define FAIR_TIME_SLICE 50
+
+//struct for walking the ready processes once, in the order
+//they'd be dispatched: the EDF queue, the fair tree, then
+//the ready queue.
+//stage: which of the three the walk has reached.
+//index: the next position in the EDF queue or the ready queue.
+//node: the next node of the fair tree.
+struct ReadyCursor {
+	int stage;
+	int index;
+	RBNode* node;
+};
+
+typedef struct ReadyCursor ReadyCursor;
+
+//in M mode, a process waits for the processor it last ran on
+//rather than migrate, unless that processor has at least this many
+//more ready processes waiting for it than the free processor does.
+#define MIGRATION_THRESHOLD 2
+
+//the number of processes that can be started ahead of a process
+//waiting for its own processor before it migrates anyway.
+#define AFFINITY_AGING_LIMIT 20
+
+//how long free processors are held for a process group that
+//doesn't fit yet before the processes behind it may use them.
+#define GANG_HOLD_TIME 200
+
+//how many different process groups one dispatch scan remembers
+//trying. groups past this are just tried again.
+#define MAX_GANGS_PER_SCAN 16
+
+//a process woken from a disk or message wait gets a boost,
+//measured in levels. under the priority policy a level is one
+//priority point. under the fair policy a level lets the process
+//start FAIR_BOOST_CREDIT below the minimum vruntime.
+//a boost loses one level per BOOST_DECAY_TIME of CPU time the
+//process runs, so a process that wakes from I/O and then computes
+//for a long time can't hold on to it. boosts are off unless boost= is given.
+//EDF processes never get one: they're ordered by deadline, and
+//a boost would let them run ahead of the deadlines they were admitted with.
+#define DEFAULT_WAKEUP_BOOST 0
+#define MAX_WAKEUP_BOOST 10
+#define FAIR_BOOST_CREDIT 20
+#define BOOST_DECAY_TIME 50
+#define NUM_SCHED_CLASSES 2
+
+//the states a process can be listed under in schedule prints.
+//a process that is running, or not waiting for anything, is in none.
+#define SCHED_STATE_NONE 0
+#define SCHED_STATE_READY 1
+#define SCHED_STATE_TIMER 2
+#define SCHED_STATE_SUSPENDED 3
+#define SCHED_STATE_MESSAGE 4
+#define SCHED_STATE_DISK 5
+#define NUM_SCHED_STATES 6
+
 int readyQueueId;
+int edfQueueId; //ready EDF processes, ordered by absolute deadline.
 int suspendQueueId;
+int schedulingPolicy; //SCHED_POLICY_PRIORITY or SCHED_POLICY_FAIR.
+long wakeupBoost[NUM_SCHED_CLASSES]; //the boost given on wakeup, per scheduling class.
 int schedulePrintLimit;
 
 void initReadyQueue();
 void initSuspendQueue();
 void dispatch();
 int readyQueueIsEmpty();
+void setScheduleState(Process* process, int state);
 void addToReadyQueue(Process* process);
+void insertReady(Process* process);
+void requeueReady(Process* process);
 long terminateProcess(long pid);
 long suspendProcess(long pid);
 long resumeProcess(long pid);
 void multidispatcher();
 void startMultidispatcher();
+void initSchedulingInfo(Process* process);
+Process* removeNextReady();
+int removeFromReadyQueue(Process* process);
+int isInReadyQueue(Process* process);
+long setDeadline(long pid, long period, long relativeDeadline, long budget);
+void completeEdfJob(Process* process);
+void enforceEdfBudget(Process* process);
+void enforceFairShare(Process* process);
+void printEdfReport();
+void chargeRuntime(Process* process);
+int claimProcessor(Process* process, int processor);
+void releaseProcessor(Process* process);
+void switchTo(Process* target);
+void wakeProcess(Process* process);
+void applyWakeupBoost(Process* process);
+void decayBoost(Process* process, long ran);
+long effectivePriority(Process* process);
 
 #endif /* DISPATCHER_H_ */
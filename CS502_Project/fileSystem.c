@@ -13,6 +13,7 @@
 #include "processManager.h"
 #include "fileSystem.h"
 #include "memoryManager.h"
+#include "volumeManager.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -26,6 +27,28 @@ typedef struct {
 
 } OpenFile;
 
+//A block of file data held in the buffer cache.
+//the block's contents stay in diskContents. the cache keeps
+//track of which blocks are held and which have to be written back.
+//volume, sector: where the block lives. sector is -1 if the slot is empty.
+//inode: the file the block belongs to.
+//dirty: whether the block has changed since it was written to disk.
+//writing: whether the block is being written back.
+//version: goes up each time the block changes, so a write back
+//can tell whether it wrote the latest data.
+//lastUsed: the write that last used the block.
+typedef struct {
+
+	long volume;
+	long sector;
+	long inode;
+	int dirty;
+	int writing;
+	long version;
+	long lastUsed;
+
+} CacheBlock;
+
 //TODO: find the bug in test29 that causes occaisional freezing
 
 void initDiskContents();
@@ -37,6 +60,8 @@ void insertName(char* fileName, unsigned char* buffer);
 int hasName(unsigned char* buffer, char* fileName);
 OpenFile* isOpen(int inode);
 char* getName(unsigned char* buffer);
+void initBufferCache();
+void useCacheBlock(long volume, long sector, long inode, char* buffer, int isWrite);
 
 int rootSector = 0x11; //the sectors of the root directory and bitmap.
 int bitmapSector = 0x01;
@@ -46,6 +71,15 @@ int openFilesQueueId;
 
 unsigned char** diskContents; //the contents of the disk stored in memory.
 
+CacheBlock bufferCache[BUFFER_CACHE_SIZE];
+char* fileDataSectors; //1 for each sector holding file data, which the cache writes to disk.
+long cacheClock; //counts writes to the cache, to find the least recently used block.
+long cacheReads; //file data reads made through the cache.
+long cacheDiskReads; //reads of blocks the cache didn't hold, which went to the disk.
+long cacheWrites; //file data writes made through the cache.
+long cacheAbsorbed; //writes to a block that was already dirty, which saved a disk write.
+long cacheWriteBacks; //blocks written to disk.
+
 /**
  * Initializes all structures needed by the file system.
  * That is, the disk cache and the open files queue.
@@ -54,6 +88,8 @@ void initFileSystem() {
 
 	openFilesQueueId = QCreate("openFilesQ");
 	initDiskContents();
+	initVolumes();
+	initBufferCache();
 
 }
 
@@ -77,6 +113,7 @@ int formatDisk(int diskID) {
 	}
 
 	formattedDisk = diskID;
+	createVolume(diskID);
 
 	unsigned char* sectorZeroBuffer = malloc(PGSIZE * sizeof(char));
 
@@ -117,7 +154,7 @@ int formatDisk(int diskID) {
 	sectorZeroBuffer[11] = 0x06;
 	sectorZeroBuffer[10] = 0x00;
 
-	writeToDisk(diskID, 0, (char*)sectorZeroBuffer);
+	writeToVolume(diskID, 0, (char*)sectorZeroBuffer);
 
 	bufferCopy(sectorZeroBuffer, diskContents[0]);
 
@@ -129,10 +166,19 @@ int formatDisk(int diskID) {
 		tempBuffer[i] = 0xFF;
 	}
 
-	writeToDisk(diskID, 0x0D, (char*)tempBuffer);
-	writeToDisk(diskID, 0x0E, (char*)tempBuffer);
-	writeToDisk(diskID, 0x0F, (char*)tempBuffer);
-	writeToDisk(diskID, 0x10, (char*)tempBuffer);
+	//these sectors all get the same contents, so they go as one transfer.
+	char* swapBitmapBuffers[4];
+
+	for(int i = 0; i<4; i++) {
+		swapBitmapBuffers[i] = (char*)tempBuffer;
+	}
+
+	DiskRequest* writes[MAX_NUMBER_OF_DISKS];
+	int numWrites = submitVolumeWrite(diskID, 0x0D, 4, swapBitmapBuffers, writes);
+
+	for(int i = 0; i<numWrites; i++) {
+		waitForDiskRequest(writes[i]);
+	}
 
 	bufferCopy(tempBuffer, diskContents[0x0D]);
 	bufferCopy(tempBuffer, diskContents[0x0E]);
@@ -146,7 +192,7 @@ int formatDisk(int diskID) {
 		tempBuffer[i] = 0x00;
 	}
 
-	writeToDisk(diskID, bitmapSector, (char*)tempBuffer);
+	writeToVolume(diskID, bitmapSector, (char*)tempBuffer);
 
 	bufferCopy(tempBuffer, diskContents[bitmapSector]);
 
@@ -186,7 +232,7 @@ int formatDisk(int diskID) {
 	tempBuffer[15] = 0x00;
 	tempBuffer[14] = 0x00;
 
-	writeToDisk(diskID, rootSector, (char*)tempBuffer);
+	writeToVolume(diskID, rootSector, (char*)tempBuffer);
 
 	bufferCopy(tempBuffer, diskContents[rootSector]);
 
@@ -208,7 +254,7 @@ int formatDisk(int diskID) {
 	tempBuffer[14] = 0x1A;
 	tempBuffer[15] = 0x00;
 
-	writeToDisk(diskID, 0x12, (char*)tempBuffer);
+	writeToVolume(diskID, 0x12, (char*)tempBuffer);
 
 	bufferCopy(tempBuffer, diskContents[0x12]);
 
@@ -264,9 +310,21 @@ void initDiskContents() {
  * diskContents to disk
  * so that they can be
  * shown in checkDisk.
+ * File data is left to the buffer cache, which
+ * writes back the blocks that changed.
+ * The sectors go through the volume, so each
+ * lands on the member disks that hold it.
+ * Runs of consecutive sectors are
+ * written together, and all are
+ * submitted before any is waited for.
+ * Parameters:
+ * diskID: the disk the volume was formatted on.
  */
 void flushDiskContents(int diskID) {
 
+	//1 for each sector that needs writing.
+	char* toWrite = calloc(NUMBER_LOGICAL_SECTORS, sizeof(char));
+
 	//diskContentsLock();
 	long index = 0;
 	//update the bitmap and all
@@ -280,7 +338,7 @@ void flushDiskContents(int diskID) {
 		if(isUnwritten(sector)) {
 			break;
 		} else {
-			writeToDisk(diskID, i, (char*)sector);
+			toWrite[i] = 1;
 		}
 
 		for(int j = 0; j<PGSIZE; j++) {
@@ -291,9 +349,9 @@ void flushDiskContents(int diskID) {
 				int masked = sector[j] & (1 << shiftAmount);
 
 				//if we find a bit.
-				if(masked >> shiftAmount == 1) {
+				if(masked >> shiftAmount == 1 && index < NUMBER_LOGICAL_SECTORS) {
 
-					writeToDisk(diskID, index, (char*)diskContents[index]);
+					toWrite[index] = 1;
 
 				}
 
@@ -310,11 +368,53 @@ void flushDiskContents(int diskID) {
 	for(int i = SWAP_LOCATION; i<SWAP_LOCATION+SWAP_SIZE; i++) {
 
 		if(!isUnwritten(diskContents[i])) {
-			writeToDisk(diskID, i, (char*)diskContents[i]);
+			toWrite[i] = 1;
+		}
+
+	}
+
+	for(int i = 0; i<NUMBER_LOGICAL_SECTORS; i++) {
+
+		if(fileDataSectors[i]) {
+			toWrite[i] = 0;
+		}
+
+	}
+
+	//enough for a request per sector on each member.
+	DiskRequest** writes = malloc(NUMBER_LOGICAL_SECTORS * MAX_NUMBER_OF_DISKS * sizeof(DiskRequest*));
+	int numWrites = 0;
+	int sector = 0;
+
+	//diskContents holds a buffer per sector, so a run's
+	//buffer list is just its slice of diskContents.
+	while(sector < NUMBER_LOGICAL_SECTORS) {
+
+		if(!toWrite[sector]) {
+			++sector;
+			continue;
 		}
 
+		int count = 0;
+
+		while(sector + count < NUMBER_LOGICAL_SECTORS && toWrite[sector + count]
+				&& count < MAX_DISK_IO_VECTOR) {
+			++count;
+		}
+
+		numWrites += submitVolumeWrite(diskID, sector, count,
+				(char**)&diskContents[sector], &writes[numWrites]);
+		sector += count;
+
 	}
 
+	for(int i = 0; i<numWrites; i++) {
+		waitForDiskRequest(writes[i]);
+	}
+
+	free(writes);
+	free(toWrite);
+
 }
 
 /*
@@ -338,6 +438,7 @@ long findOpenSector() {
 			sector[0] = sector[0] | (1 << 7);
 			bufferCopy(sector, diskContents[i]);
 			free(tempBuffer);
+			fileDataSectors[index] = 0;
 			return index;
 		}
 
@@ -352,9 +453,11 @@ long findOpenSector() {
 				if(masked >> shiftAmount != 1) {
 
 					//flip the bit, then write.
+					//whatever the sector held before, it isn't file data now.
 					sector[j] = sector[j] | (1 << shiftAmount);
 					bufferCopy(sector, diskContents[i]);
 					free(tempBuffer);
+					fileDataSectors[index] = 0;
 					return index;
 				}
 
@@ -970,8 +1073,7 @@ int writeFile(long inode, int logicalBlock, char* writeBuffer) {
 	fileHeader[15] = (fileSize >> 8) & 0xFF;
 	fileHeader[14] = fileSize & 0xFF;
 
-	bufferCopy((unsigned char*)writeBuffer, diskContents[dataBlockSector]);
-	writeToDisk(currentProcess()->currentDisk, dataBlockSector, writeBuffer);
+	useCacheBlock(currentProcess()->currentDisk, dataBlockSector, inode, writeBuffer, 1);
 
 	return 0;
 
@@ -1009,7 +1111,7 @@ int readFile(long inode, int logicalBlock, char* readBuffer) {
 	int dataBlockSector = findDataBlockSector(logicalBlock, topIndexSector);
 	diskContentsUnlock();
 
-	readFromDisk(currentProcess()->currentDisk, dataBlockSector, readBuffer);
+	useCacheBlock(currentProcess()->currentDisk, dataBlockSector, inode, readBuffer, 0);
 	return 0;
 }
 
@@ -1021,14 +1123,14 @@ int readFile(long inode, int logicalBlock, char* readBuffer) {
  */
 OpenFile* isOpen(int inode) {
 
-	openFilesLock();
+	openFilesReadLock();
 	int i = 0;
 	OpenFile* curr = QWalk(openFilesQueueId, i);
 
 	while((int)curr != -1) {
 
 		if(curr->inode == inode) {
-			openFilesUnlock();
+			openFilesReadUnlock();
 			return curr;
 		}
 
@@ -1036,7 +1138,7 @@ OpenFile* isOpen(int inode) {
 		curr = QWalk(openFilesQueueId, i);
 	}
 
-	openFilesUnlock();
+	openFilesReadUnlock();
 	return (OpenFile*)-1;
 
 }
@@ -1057,12 +1159,327 @@ int closeFile(long inode) {
 		openFilesLock();
 		QRemoveItem(openFilesQueueId, file);
 		openFilesUnlock();
+		writeBackCache(inode);
 		flushDiskContents(currentProcess()->currentDisk);
 		return 0;
 	}
 
 }
 
+/**
+ * Writes every changed block in the buffer cache
+ * to disk, then the file system's own sectors.
+ * Returns 0 if successful.
+ */
+int syncFileSystem() {
+
+	writeBackCache(-1);
+
+	if(formattedDisk != -1) {
+		flushDiskContents(formattedDisk);
+	}
+
+	return 0;
+
+}
+
+/**
+ * Empties the buffer cache.
+ */
+void initBufferCache() {
+
+	for(int i = 0; i<BUFFER_CACHE_SIZE; i++) {
+		bufferCache[i].sector = -1;
+		bufferCache[i].dirty = 0;
+		bufferCache[i].writing = 0;
+		bufferCache[i].version = 0;
+	}
+
+	fileDataSectors = calloc(NUMBER_LOGICAL_SECTORS, sizeof(char));
+	cacheClock = 0;
+	cacheReads = 0;
+	cacheDiskReads = 0;
+	cacheWrites = 0;
+	cacheAbsorbed = 0;
+	cacheWriteBacks = 0;
+
+}
+
+/**
+ * Finds a block in the buffer cache.
+ * The caller must hold the cache lock.
+ * Parameters:
+ * volume, sector: where the block lives.
+ * Returns the block, or -1 if it isn't cached.
+ */
+CacheBlock* findCacheBlock(long volume, long sector) {
+
+	for(int i = 0; i<BUFFER_CACHE_SIZE; i++) {
+
+		if(bufferCache[i].sector == sector && bufferCache[i].volume == volume) {
+			return &bufferCache[i];
+		}
+
+	}
+
+	return (CacheBlock*)-1;
+
+}
+
+/**
+ * Picks the slot a new block should go in: an empty one if
+ * there is one, otherwise the least recently used block that
+ * isn't being written back.
+ * The caller must hold the cache lock.
+ * Returns the slot, or -1 if every block is being written back.
+ */
+CacheBlock* chooseCacheVictim() {
+
+	CacheBlock* victim = (CacheBlock*)-1;
+
+	for(int i = 0; i<BUFFER_CACHE_SIZE; i++) {
+
+		CacheBlock* block = &bufferCache[i];
+
+		if(block->sector == -1) {
+			return block;
+		}
+
+		if(!block->writing && ((int)victim == -1 || block->lastUsed < victim->lastUsed)) {
+			victim = block;
+		}
+
+	}
+
+	return victim;
+
+}
+
+/**
+ * Writes a cached block to disk if it has changed.
+ * The data is copied out of diskContents first, so the
+ * block can keep being used while the write is under way.
+ * The caller must not hold the cache lock.
+ * Parameters:
+ * block: the block to write back.
+ */
+void writeBackBlock(CacheBlock* block) {
+
+	cacheLock();
+
+	if(block->sector == -1 || !block->dirty || block->writing) {
+		cacheUnlock();
+		return;
+	}
+
+	long volume = block->volume;
+	long sector = block->sector;
+	long version = block->version;
+	char* data = malloc(PGSIZE);
+	memcpy(data, diskContents[sector], PGSIZE);
+	block->writing = 1;
+	++cacheWriteBacks;
+
+	cacheUnlock();
+
+	writeToVolume(volume, sector, data);
+
+	cacheLock();
+
+	//a block being written back is never evicted, so it's
+	//still this sector. if it changed while we wrote, it's still dirty.
+	if(block->version == version) {
+		block->dirty = 0;
+	}
+
+	block->writing = 0;
+	cacheUnlock();
+
+	free(data);
+
+}
+
+/**
+ * Reads or writes a block of file data through the buffer cache.
+ * A block the cache holds is read from diskContents. One it doesn't
+ * hold is read from its volume, so a mirrored volume can spread the
+ * reads over its members. A read never takes a slot: the cache only
+ * holds blocks so their changes can be written back later.
+ * A write goes to diskContents and marks the block dirty; it reaches
+ * the disk when it's evicted, its file is closed, or on a sync.
+ * A block that isn't cached takes the least recently used slot,
+ * and if that block is dirty it's written back first.
+ * Parameters:
+ * volume, sector: where the block lives.
+ * inode: the file the block belongs to.
+ * buffer: the data to write, or where to put the data read.
+ * isWrite: 1 to write the block, 0 to read it.
+ */
+void useCacheBlock(long volume, long sector, long inode, char* buffer, int isWrite) {
+
+	if(!isWrite) {
+
+		cacheLock();
+		++cacheReads;
+
+		//a block that was never written has nothing on disk to read.
+		if((int)findCacheBlock(volume, sector) != -1 || !fileDataSectors[sector]) {
+			memcpy(buffer, diskContents[sector], PGSIZE);
+			cacheUnlock();
+			return;
+		}
+
+		//a block the cache doesn't hold is the same on disk.
+		++cacheDiskReads;
+		cacheUnlock();
+		readFromVolume(volume, sector, buffer);
+		return;
+
+	}
+
+	while(1) {
+
+		cacheLock();
+		CacheBlock* block = findCacheBlock(volume, sector);
+
+		if((int)block == -1) {
+
+			CacheBlock* victim = chooseCacheVictim();
+
+			//the victim has to reach the disk before its slot is
+			//reused. then look again, since things may have changed.
+			if((int)victim != -1 && victim->sector != -1 && victim->dirty) {
+				cacheUnlock();
+				writeBackBlock(victim);
+				continue;
+			}
+
+			++cacheWrites;
+
+			//every block is being written back. go around the cache.
+			if((int)victim == -1) {
+
+				memcpy(diskContents[sector], buffer, PGSIZE);
+				fileDataSectors[sector] = 1;
+				char* data = malloc(PGSIZE);
+				memcpy(data, buffer, PGSIZE);
+				cacheUnlock();
+				writeToVolume(volume, sector, data);
+				free(data);
+				return;
+
+			}
+
+			block = victim;
+			block->volume = volume;
+			block->sector = sector;
+			block->dirty = 0;
+			block->writing = 0;
+
+		} else {
+
+			++cacheWrites;
+
+			if(block->dirty) {
+				++cacheAbsorbed;
+			}
+
+		}
+
+		memcpy(diskContents[sector], buffer, PGSIZE);
+		fileDataSectors[sector] = 1;
+		block->inode = inode;
+		block->dirty = 1;
+		++block->version;
+		block->lastUsed = ++cacheClock;
+		cacheUnlock();
+		return;
+
+	}
+
+}
+
+/**
+ * Writes back the changed blocks of a file, or of every file.
+ * All the writes are submitted before any is waited for,
+ * so the member disks of a volume work on them together.
+ * Parameters:
+ * inode: the file whose blocks to write, or -1 for all files.
+ */
+void writeBackCache(long inode) {
+
+	CacheBlock* blocks[BUFFER_CACHE_SIZE];
+	long versions[BUFFER_CACHE_SIZE];
+	char* data[BUFFER_CACHE_SIZE];
+	int numBlocks = 0;
+
+	cacheLock();
+
+	for(int i = 0; i<BUFFER_CACHE_SIZE; i++) {
+
+		CacheBlock* block = &bufferCache[i];
+
+		if(block->sector == -1 || !block->dirty || block->writing
+				|| (inode != -1 && block->inode != inode)) {
+			continue;
+		}
+
+		block->writing = 1;
+		blocks[numBlocks] = block;
+		versions[numBlocks] = block->version;
+		data[numBlocks] = malloc(PGSIZE);
+		memcpy(data[numBlocks], diskContents[block->sector], PGSIZE);
+		++numBlocks;
+		++cacheWriteBacks;
+
+	}
+
+	cacheUnlock();
+
+	DiskRequest* writes[BUFFER_CACHE_SIZE * MAX_NUMBER_OF_DISKS];
+	int numWrites = 0;
+
+	for(int i = 0; i<numBlocks; i++) {
+		numWrites += submitVolumeWrite(blocks[i]->volume, blocks[i]->sector, 1,
+				&data[i], &writes[numWrites]);
+	}
+
+	for(int i = 0; i<numWrites; i++) {
+		waitForDiskRequest(writes[i]);
+	}
+
+	cacheLock();
+
+	for(int i = 0; i<numBlocks; i++) {
+
+		//if it changed while we wrote, it's still dirty.
+		if(blocks[i]->version == versions[i]) {
+			blocks[i]->dirty = 0;
+		}
+
+		blocks[i]->writing = 0;
+		free(data[i]);
+
+	}
+
+	cacheUnlock();
+
+}
+
+/**
+ * Prints how well the buffer cache did.
+ */
+void printBufferCacheStats() {
+
+	if(cacheReads + cacheWrites == 0) {
+		return;
+	}
+
+	aprintf("\nBuffer cache: %ld reads, %ld from the disk, %ld writes, %ld to blocks not yet written back, %ld blocks written back\n",
+			cacheReads, cacheDiskReads, cacheWrites, cacheAbsorbed, cacheWriteBacks);
+
+}
+
 /**
  * Retrieves the name of a file from a file header.
  * Parameters:
@@ -14,6 +14,9 @@
 #define SWAP_SIZE 4*0x80
 #define SWAP_LOCATION 0x600
 
+//how many file data blocks the buffer cache holds.
+#define BUFFER_CACHE_SIZE 32
+
 int formatDisk(int diskID);
 int openDir(int diskID, char* directoryName);
 void flushDiskContents(int diskID);
@@ -22,6 +25,9 @@ int createFile(char* directoryName);
 int openFile(char* fileName);
 int writeFile(long inode, int logicalBlock, char* writeBuffer);
 int closeFile(long inode);
+int syncFileSystem();
+void writeBackCache(long inode);
+void printBufferCacheStats();
 int readFile(long inode, int logicalBlock, char* readBuffer);
 void dirContents();
 void bufferCopy(unsigned char* src, unsigned char* dest);
@@ -111,6 +111,10 @@ typedef         int                             BOOL;
 #define      Z502GetCurrentContext        12
 #define      Z502SetProcessorNumber       13
 #define      Z502GetProcessorNumber       14
+#define      Z502DiskReadVector           15
+#define      Z502DiskWriteVector          16
+#define      Z502DiskSetTiming            17
+#define      Z502DestroyContext           18
 
 // This is the memory Mapped IO Data Structure.  It is an integral
 // part of all Mapped IO.  It's required that this be filled in by
@@ -124,6 +128,51 @@ typedef struct  {
 	long         Field4;
 } MEMORY_MAPPED_IO;
 
+//  A vectored disk read or write moves SectorCount consecutive
+//  sectors, starting at the sector in Field2, to or from the
+//  buffers listed here - one sector per buffer.  Field3 holds the
+//  address of this structure.  The whole transfer pays for one seek
+//  and raises one interrupt.
+#define         MAX_DISK_IO_VECTOR              (short)32
+
+//  Each disk accepts up to this many requests at once: the one it's
+//  working on, plus ones it holds and serves in order of head distance.
+//  Writing a disk returns the request's tag in Field2, and the disk
+//  interrupt for that request gives the tag in Field3.
+#define         DISK_QUEUE_DEPTH                (short)4
+
+typedef struct  {
+	long         SectorCount;
+	char         *Buffers[MAX_DISK_IO_VECTOR];
+} DISK_IO_VECTOR;
+
+//  How long a disk takes to serve a request depends on its timing
+//  model.  Disks start out LINEAR; Z502DiskSetTiming gives a disk
+//  another model.  Field1 is the disk and Field3 holds the address
+//  of a DISK_TIMING.  A request always pays AccessTime, then:
+//  LINEAR - the head distance in sectors / SeekDivisor, plus
+//      TransferTime for each sector after the first.
+//  ROTATIONAL - sectors lie on tracks of SectorsPerTrack.  The head
+//      pays SeekTime for each track it crosses, then waits for the
+//      first sector to come round (the platter turns once every
+//      RotationTime) and reads sectors as they pass under it.
+//  FLASH - no seek.  Sectors move Channels at a time, TransferTime
+//      for each round.
+#define         DISK_TIMING_LINEAR              0
+#define         DISK_TIMING_ROTATIONAL          1
+#define         DISK_TIMING_FLASH               2
+
+typedef struct  {
+	long         Model;
+	long         AccessTime;
+	long         SeekDivisor;                   // LINEAR
+	long         TransferTime;                  // LINEAR and FLASH
+	long         SeekTime;                      // ROTATIONAL
+	long         SectorsPerTrack;               // ROTATIONAL
+	long         RotationTime;                  // ROTATIONAL
+	long         Channels;                      // FLASH
+} DISK_TIMING;
+
 //  These are the allowable locations for hardware synchronization support
 #define      MEMORY_INTERLOCK_BASE     0x7FE00000
 #define      MEMORY_INTERLOCK_SIZE     0x00000100
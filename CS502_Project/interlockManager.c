@@ -0,0 +1,280 @@
+/*
+ * interlockManager.c
+ *
+ *  Created on: Oct 22, 2019
+ *      Author: jean-philippe
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "global.h"
+#include "syscalls.h"
+#include "protos.h"
+#include "moreGlobals.h"
+#include "interlockManager.h"
+#include "processManager.h"
+#include "dispatcher.h"
+#include "schedTrace.h"
+
+Interlock interlocks[NUM_INTERLOCKS];
+
+void updateInheritance(Process* holder);
+
+/**
+ * Marks every interlock as free.
+ */
+void initInterlocks() {
+
+	for(int i = 0; i < NUM_INTERLOCKS; i++) {
+		interlocks[i].ownerPid = -1;
+		interlocks[i].waitQueueId = -1;
+	}
+
+}
+
+/**
+ * Returns the most urgent priority among the processes
+ * waiting on interlocks a given process holds.
+ * The caller must hold the interlock lock.
+ * Parameters:
+ * pid: the holder's pid.
+ * Returns the priority, or -1 if nobody is waiting on it.
+ */
+long waiterPriority(long pid) {
+
+	long best = -1;
+
+	for(int i = 0; i < NUM_INTERLOCKS; i++) {
+
+		if(interlocks[i].ownerPid != pid || interlocks[i].waitQueueId == -1) {
+			continue;
+		}
+
+		int j = 0;
+		Process* waiter = (Process*)QWalk(interlocks[i].waitQueueId, j);
+
+		while((int)waiter != -1) {
+
+			long priority = effectivePriority(waiter);
+
+			if(best == -1 || priority < best) {
+				best = priority;
+			}
+
+			++j;
+			waiter = (Process*)QWalk(interlocks[i].waitQueueId, j);
+
+		}
+
+	}
+
+	return best;
+
+}
+
+/**
+ * Recomputes the priority a holder inherits from its waiters,
+ * moving it in the ready queue if that changes. If the holder is
+ * itself waiting on an interlock, the change is passed on to that
+ * interlock's holder, and so on down the chain.
+ * The caller must hold the interlock lock.
+ * Parameters:
+ * holder: the process to update. Ignored if it's -1.
+ */
+void updateInheritance(Process* holder) {
+
+	//a chain can't be longer than the number of interlocks.
+	for(int depth = 0; depth < NUM_INTERLOCKS && (int)holder != -1; depth++) {
+
+		long inherited = waiterPriority(holder->pid);
+
+		if(inherited == holder->inheritedPriority) {
+			return;
+		}
+
+		holder->inheritedPriority = inherited;
+
+		readyLock();
+		requeueReady(holder);
+		readyUnlock();
+
+		if(holder->waitingOnInterlock == -1) {
+			return;
+		}
+
+		holder = getProcess(interlocks[holder->waitingOnInterlock].ownerPid);
+
+	}
+
+}
+
+/**
+ * Locks an interlock for the current process,
+ * waiting for it if it's held and suspend is TRUE.
+ * Parameters:
+ * lock: the interlock to take.
+ * suspend: whether to wait if someone else holds it.
+ * Returns TRUE if the current process now holds it, FALSE otherwise.
+ */
+int lockInterlock(Interlock* lock, long suspend) {
+
+	Process* current = currentProcess();
+
+	interlockLock();
+
+	//like the hardware, locking a lock we already hold succeeds.
+	if(lock->ownerPid == -1 || lock->ownerPid == current->pid) {
+		lock->ownerPid = current->pid;
+		interlockUnlock();
+		return TRUE;
+	}
+
+	if(suspend == FALSE) {
+		interlockUnlock();
+		return FALSE;
+	}
+
+	if(lock->waitQueueId == -1) {
+		lock->waitQueueId = QCreate("interlockQ");
+	}
+
+	QInsertOnTail(lock->waitQueueId, current);
+	current->waitingOnInterlock = lock - interlocks;
+	traceEvent(TRACE_BLOCK, current, TRACE_REASON_INTERLOCK);
+
+	//the holder now runs at least at our priority until it lets go.
+	updateInheritance(getProcess(lock->ownerPid));
+	interlockUnlock();
+
+	//the unlocking process hands the lock straight to us,
+	//so by the time we run again we hold it.
+	dispatch();
+
+	return TRUE;
+
+}
+
+/**
+ * Unlocks an interlock held by the current process.
+ * If anyone is waiting for it, the first waiter
+ * becomes the holder and is made ready.
+ * Parameters:
+ * lock: the interlock to release.
+ * Returns TRUE if it was released, FALSE if the
+ * current process didn't hold it.
+ */
+int unlockInterlock(Interlock* lock) {
+
+	Process* current = currentProcess();
+
+	interlockLock();
+
+	if(lock->ownerPid != current->pid) {
+		interlockUnlock();
+		return FALSE;
+	}
+
+	Process* next = (Process*)-1;
+
+	if(lock->waitQueueId != -1) {
+		next = (Process*)QRemoveHead(lock->waitQueueId);
+	}
+
+	if((int)next != -1) {
+		lock->ownerPid = next->pid;
+		next->waitingOnInterlock = -1;
+	} else {
+		lock->ownerPid = -1;
+	}
+
+	//we give up whatever we inherited through this lock,
+	//and the new holder inherits from those still waiting.
+	updateInheritance(current);
+
+	if((int)next != -1) {
+		updateInheritance(next);
+	}
+
+	interlockUnlock();
+
+	if((int)next != -1) {
+		traceEvent(TRACE_WAKE, next, TRACE_REASON_INTERLOCK);
+		addToReadyQueue(next);
+	}
+
+	return TRUE;
+
+}
+
+/**
+ * Carries out a READ_MODIFY on a user interlock.
+ * Parameters:
+ * address: the interlock's address, in the
+ * MEMORY_INTERLOCK_BASE range.
+ * newValue: 1 to lock, 0 to unlock.
+ * suspend: when locking, whether to wait if it's held.
+ * Returns TRUE if the action succeeded, FALSE otherwise.
+ */
+int readModify(long address, long newValue, long suspend) {
+
+	if(address < MEMORY_INTERLOCK_BASE || address >= MEMORY_INTERLOCK_BASE + NUM_INTERLOCKS
+			|| (newValue != 0 && newValue != 1)
+			|| (suspend != TRUE && suspend != FALSE)) {
+		return FALSE;
+	}
+
+	Interlock* lock = &interlocks[address - MEMORY_INTERLOCK_BASE];
+
+	if(newValue == 1) {
+		return lockInterlock(lock, suspend);
+	} else {
+		return unlockInterlock(lock);
+	}
+
+}
+
+/**
+ * Gives up every interlock a terminating process holds
+ * or is waiting for, so nobody waits on it forever.
+ * Parameters:
+ * process: the process being terminated.
+ */
+void releaseInterlocks(Process* process) {
+
+	for(int i = 0; i < NUM_INTERLOCKS; i++) {
+
+		Interlock* lock = &interlocks[i];
+		Process* next = (Process*)-1;
+
+		interlockLock();
+
+		//a waiter leaving may lower what the holder inherits.
+		if(lock->waitQueueId != -1 && (int)QRemoveItem(lock->waitQueueId, process) != -1) {
+			updateInheritance(getProcess(lock->ownerPid));
+		}
+
+		if(lock->ownerPid == process->pid) {
+
+			if(lock->waitQueueId != -1) {
+				next = (Process*)QRemoveHead(lock->waitQueueId);
+			}
+
+			lock->ownerPid = (int)next != -1 ? next->pid : -1;
+
+			if((int)next != -1) {
+				next->waitingOnInterlock = -1;
+				updateInheritance(next);
+			}
+
+		}
+
+		interlockUnlock();
+
+		if((int)next != -1) {
+			traceEvent(TRACE_WAKE, next, TRACE_REASON_INTERLOCK);
+			addToReadyQueue(next);
+		}
+
+	}
+
+}
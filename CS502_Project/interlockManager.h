@@ -0,0 +1,36 @@
+/*
+ * interlockManager.h
+ *
+ *  Created on: Oct 22, 2019
+ *      Author: jean-philippe
+ */
+//intended to contain the OS's handling of user interlocks.
+//a user process locking an interlock that another process holds
+//is put on that interlock's wait queue, and the CPU goes to
+//someone else until the holder unlocks it.
+
+#ifndef INTERLOCKMANAGER_H_
+#define INTERLOCKMANAGER_H_
+
+#include "global.h"
+#include "moreGlobals.h"
+
+//the number of interlock addresses, starting at MEMORY_INTERLOCK_BASE.
+#define NUM_INTERLOCKS MEMORY_INTERLOCK_SIZE
+
+//struct for one user interlock.
+//ownerPid: the pid of the process holding it, or -1 if it's free.
+//waitQueueId: processes waiting for it, in arrival order.
+//-1 until someone first has to wait.
+struct Interlock {
+	long ownerPid;
+	int waitQueueId;
+};
+
+typedef struct Interlock Interlock;
+
+void initInterlocks();
+int readModify(long address, long newValue, long suspend);
+void releaseInterlocks(Process* process);
+
+#endif /* INTERLOCKMANAGER_H_ */
@@ -12,244 +12,259 @@
 #include "limits.h"
 #include "processManager.h"
 #include "dispatcher.h"
+#include "schedTrace.h"
+#include "osLock.h"
+#include "diskManager.h"
+#include "fileSystem.h"
 #include <string.h>
 #include <stdlib.h>
-#define                  DO_LOCK                     1
-#define                  DO_UNLOCK                   0
-#define                  SUSPEND_UNTIL_LOCKED        TRUE
-#define                  DO_NOT_SUSPEND              FALSE
-#define					 TIMER_LOCK 				 MEMORY_INTERLOCK_BASE
-#define					 DISK_LOCK  				 MEMORY_INTERLOCK_BASE+1
-#define					 MSG_LOCK   				 MEMORY_INTERLOCK_BASE+2
-#define					 SUSPEND_LOCK 				 MEMORY_INTERLOCK_BASE+3
-#define					 READY_LOCK 				 MEMORY_INTERLOCK_BASE+4
-#define					 PROCESS_LOCK 				 MEMORY_INTERLOCK_BASE+5
-#define					 MSG_SUSPEND_LOCK 			 MEMORY_INTERLOCK_BASE+6
-#define					 DISK_CONTENTS_LOCK			 MEMORY_INTERLOCK_BASE+7
-#define					 OPEN_FILES_LOCK			 MEMORY_INTERLOCK_BASE+8
-#define					 MEMORY_LOCK			     MEMORY_INTERLOCK_BASE+9
-#define					 SWAP_LOCK					 MEMORY_INTERLOCK_BASE+10
+#define					 TIMER_LOCK 				 0
+#define					 DISK_LOCK  				 1
+#define					 MSG_LOCK   				 2
+#define					 SUSPEND_LOCK 				 3
+#define					 READY_LOCK 				 4
+#define					 MSG_SUSPEND_LOCK 			 5
+#define					 DISK_CONTENTS_LOCK			 6
+#define					 MEMORY_LOCK			     7
+#define					 SWAP_LOCK					 8
+#define					 STATE_LOCK					 9
+#define					 INTERLOCK_LOCK				 10
+#define					 CACHE_LOCK					 11
+#define					 TRACE_LOCK					 12
+#define					 NUM_OS_LOCKS				 13
+
+//the locks guarding the OS's queues and tables.
+OsLock osLocks[NUM_OS_LOCKS] = {
+	[TIMER_LOCK] = { .name = "timer" },
+	[DISK_LOCK] = { .name = "disk" },
+	[MSG_LOCK] = { .name = "message" },
+	[SUSPEND_LOCK] = { .name = "suspend" },
+	[READY_LOCK] = { .name = "ready" },
+	[MSG_SUSPEND_LOCK] = { .name = "msgSuspend" },
+	[DISK_CONTENTS_LOCK] = { .name = "diskContents" },
+	[MEMORY_LOCK] = { .name = "memory" },
+	[SWAP_LOCK] = { .name = "swap" },
+	[STATE_LOCK] = { .name = "state" },
+	[INTERLOCK_LOCK] = { .name = "interlock" },
+	[CACHE_LOCK] = { .name = "bufferCache" },
+	[TRACE_LOCK] = { .name = "trace" },
+};
+
+//the process and open file tables are mostly looked up,
+//so lookups share these locks and only changes are exclusive.
+OsRwLock processTableLock = { .name = "process" };
+OsRwLock openFilesTableLock = { .name = "openFiles" };
 
 Message* findMessage();
 
 /**
- * Performs a hardware interlock for timer queue.
- * It attempts to lock, suspending
- * until this thread holds the lock.
+ * Takes the OS lock for timer queue.
+ * It waits until this thread holds the lock.
  */
 void timerLock() {
-	INT32 lockResult;
-	READ_MODIFY(TIMER_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[TIMER_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for timer queue.
- * It attempts to unlock, suspending
- * until this thread holds the lock.
+ * Releases the OS lock for timer queue.
  */
 void timerUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(TIMER_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[TIMER_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for disk queue.
- * It attempts to lock, suspending
- * until this thread holds the lock.
+ * Takes the OS lock for disk queue.
+ * It waits until this thread holds the lock.
  */
 void diskLock() {
-	INT32 lockResult;
-	READ_MODIFY(DISK_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[DISK_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for disk queue.
- * It attempts to unlock, suspending
- * until this thread holds the lock.
+ * Releases the OS lock for disk queue.
  */
 void diskUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(DISK_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[DISK_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for message queue.
- * It attempts to lock, suspending
- * until this thread holds the lock.
+ * Takes the OS lock for message queue.
+ * It waits until this thread holds the lock.
  */
 void msgLock() {
-	INT32 lockResult;
-	READ_MODIFY(MSG_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[MSG_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for message queue.
- * It attempts to unlock, suspending
- * until this thread holds the lock.
+ * Releases the OS lock for message queue.
  */
 void msgUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(MSG_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[MSG_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for suspend queue.
- * It attempts to lock, suspending
- * until this thread holds the lock.
+ * Takes the OS lock for suspend queue.
+ * It waits until this thread holds the lock.
  */
 void suspendLock() {
-	INT32 lockResult;
-	READ_MODIFY(SUSPEND_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[SUSPEND_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for suspend queue.
- * It attempts to unlock, suspending
- * until this thread holds the lock.
+ * Releases the OS lock for suspend queue.
  */
 void suspendUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(SUSPEND_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[SUSPEND_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for process queue.
- * It attempts to lock, suspending
- * until this thread holds the lock.
+ * Takes the OS lock for process queue.
+ * It waits until this thread holds the lock.
  */
 void processLock() {
-	INT32 lockResult;
-	READ_MODIFY(PROCESS_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osWriteLock(&processTableLock);
 }
 
 /**
- * Performs a hardware interlock for process queue.
- * It attempts to unlock, suspending
- * until this thread holds the lock.
+ * Releases the OS lock for process queue.
  */
 void processUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(PROCESS_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osWriteUnlock(&processTableLock);
 }
 
 /**
- * Performs a hardware interlock for message suspend queue.
- * It attempts to lock, suspending
- * until this thread holds the lock.
+ * Takes the process table lock for a lookup.
+ * Other lookups may hold it at the same time.
+ */
+void processReadLock() {
+	osReadLock(&processTableLock);
+}
+
+/**
+ * Releases the process table lock after a lookup.
+ */
+void processReadUnlock() {
+	osReadUnlock(&processTableLock);
+}
+
+/**
+ * Takes the OS lock for message suspend queue.
+ * It waits until this thread holds the lock.
  */
 void msgSuspendLock() {
-	INT32 lockResult;
-	READ_MODIFY(MSG_SUSPEND_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[MSG_SUSPEND_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for message suspend queue.
- * It attempts to unlock, suspending
- * until this thread holds the lock.
+ * Releases the OS lock for message suspend queue.
  */
 void msgSuspendUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(MSG_SUSPEND_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[MSG_SUSPEND_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for ready queue.
- * It attempts to lock, suspending
- * until this thread holds the lock.
+ * Takes the OS lock for ready queue.
+ * It waits until this thread holds the lock.
  */
 void readyLock() {
-	INT32 lockResult;
-	READ_MODIFY(READY_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[READY_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for ready queue.
- * It attempts to unlock, suspending
- * until this thread holds the lock.
+ * Releases the OS lock for ready queue.
  */
 void readyUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(READY_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[READY_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for disk contents
- * buffers. It attempts to lock, suspending until
- * this thread holds the lock.
+ * Takes the OS lock for disk contents buffers.
+ * It waits until this thread holds the lock.
  */
 void diskContentsLock() {
-	INT32 lockResult;
-	READ_MODIFY(DISK_CONTENTS_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[DISK_CONTENTS_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for disk contents
- * buffers. It attempts to unlock, suspending until
- * this thread holds the lock.
+ * Releases the OS lock for disk contents buffers.
  */
 void diskContentsUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(DISK_CONTENTS_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[DISK_CONTENTS_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for open files
- * queue. It attempts to lock, suspending until
- * this thread holds the lock.
+ * Takes the OS lock for open files queue.
+ * It waits until this thread holds the lock.
  */
 void openFilesLock() {
-	INT32 lockResult;
-	READ_MODIFY(OPEN_FILES_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osWriteLock(&openFilesTableLock);
 }
 
 /**
- * Performs a hardware interlock for open files
- * queue. It attempts to unlock, suspending until
- * this thread holds the lock.
+ * Releases the OS lock for open files queue.
  */
 void openFilesUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(OPEN_FILES_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osWriteUnlock(&openFilesTableLock);
 }
 
 /**
- * Performs a hardware interlock for memory.
- * It attempts to lock, suspending until
- * this thread holds the lock.
+ * Takes the open files lock for a lookup.
+ * Other lookups may hold it at the same time.
+ */
+void openFilesReadLock() {
+	osReadLock(&openFilesTableLock);
+}
+
+/**
+ * Releases the open files lock after a lookup.
+ */
+void openFilesReadUnlock() {
+	osReadUnlock(&openFilesTableLock);
+}
+
+/**
+ * Takes the OS lock for memory.
+ * It waits until this thread holds the lock.
  */
 void memLock() {
-	INT32 lockResult;
-	READ_MODIFY(MEMORY_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[MEMORY_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for memory.
- * It attempts to unlock, suspending until
- * this thread holds the lock.
+ * Releases the OS lock for memory.
  */
 void memUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(MEMORY_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[MEMORY_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for swap space.
- * It attempts to lock, suspending until
- * this thread holds the lock.
+ * Takes the OS lock for swap space.
+ * It waits until this thread holds the lock.
  */
 void swapLock() {
-	INT32 lockResult;
-	READ_MODIFY(SWAP_LOCK,DO_LOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osLock(&osLocks[SWAP_LOCK]);
 }
 
 /**
- * Performs a hardware interlock for swap space.
- * It attempts to unlock, suspending until
- * this thread holds the lock.
+ * Releases the OS lock for swap space.
  */
 void swapUnlock() {
-	INT32 lockResult;
-	READ_MODIFY(SWAP_LOCK,DO_UNLOCK,SUSPEND_UNTIL_LOCKED,&lockResult);
+	osUnlock(&osLocks[SWAP_LOCK]);
+}
+
+/**
+ * Takes the OS lock for the process state sets.
+ * It waits until this thread holds the lock.
+ */
+void stateLock() {
+	osLock(&osLocks[STATE_LOCK]);
+}
+
+/**
+ * Releases the OS lock for the process state sets.
+ */
+void stateUnlock() {
+	osUnlock(&osLocks[STATE_LOCK]);
 }
 
 /**
@@ -302,21 +317,20 @@ int addToTimerQueue(TimerRequest* request) {
 
 	long sleepUntil = request->sleepUntil;
 
-	//get the head before we insert.
+	//get the head and insert under one lock. otherwise the timer
+	//interrupt can take the head off in between and find nothing
+	//left to restart the timer for, while we see the head and don't.
 	timerLock();
 	TimerRequest* head = (TimerRequest*)QNextItemInfo(timerQueueID);
-	timerUnlock();
-
-	timerLock();
+	long headSleepUntil = (int)head != -1 ? head->sleepUntil : 0;
 	QInsert(timerQueueID, sleepUntil, request);
 	timerUnlock();
 
-
 	if((int)head != -1) {
 
 		//if our sleep time ends before
 		//the head's, we should restart.
-		if(head->sleepUntil > sleepUntil) {
+		if(headSleepUntil > sleepUntil) {
 
 			return 0;
 
@@ -327,6 +341,31 @@ int addToTimerQueue(TimerRequest* request) {
 
 }
 
+/**
+ * Takes a process's timer request off the timer
+ * queue, if it has one. The caller must hold the timer lock.
+ * Parameters:
+ * process: the process that no longer needs waking.
+ */
+void removeTimerRequest(Process* process) {
+
+	int i = 0;
+	TimerRequest* request = (TimerRequest*)QWalk(timerQueueID, i);
+
+	while((int)request != -1) {
+
+		if(request->process == process) {
+			QRemoveItem(timerQueueID, request);
+			return;
+		}
+
+		++i;
+		request = (TimerRequest*)QWalk(timerQueueID, i);
+
+	}
+
+}
+
 /**
  * A method the facilitates printing from the
  * interrupt handler. This method will only
@@ -370,6 +409,7 @@ long sendMessage(long targetPID, char* messageBuffer, long msgSendLength) {
 
 	Process* target = getProcess(targetPID);
 	Process* sender = currentProcess();
+	Process* woken = (Process*)-1; //the receiver this message wakes, if any.
 
 	//OS must restrict the number of messages present.
 	if(currentProcess()->messagesSent >= 25) {
@@ -408,7 +448,8 @@ long sendMessage(long targetPID, char* messageBuffer, long msgSendLength) {
 		while((int)suspendedProc != -1) {
 
 			QRemoveItem(msgSuspendQueueID, suspendedProc);
-			addToReadyQueue(suspendedProc);
+			traceEvent(TRACE_WAKE, suspendedProc, TRACE_REASON_MESSAGE);
+			wakeProcess(suspendedProc);
 			suspendedProc = QNextItemInfo(msgSuspendQueueID);
 
 		}
@@ -420,7 +461,7 @@ long sendMessage(long targetPID, char* messageBuffer, long msgSendLength) {
 		if((int)QItemExists(msgSuspendQueueID, target) != -1) {
 
 			QRemoveItem(msgSuspendQueueID, target);
-			addToReadyQueue(target);
+			woken = target;
 
 		}
 		msgSuspendUnlock();
@@ -428,6 +469,14 @@ long sendMessage(long targetPID, char* messageBuffer, long msgSendLength) {
 	}
 	++currentProcess()->messagesSent;
 	msgUnlock();
+
+	//the receiver is waiting on us, so let it run right away.
+	if((int)woken != -1) {
+		traceEvent(TRACE_WAKE, woken, TRACE_REASON_MESSAGE);
+		applyWakeupBoost(woken);
+		switchTo(woken);
+	}
+
 	return 0;
 
 }
@@ -502,6 +551,8 @@ long receiveMessage(long sourcePID, char* receiveBuffer, long receiveLength, lon
 		msgSuspendLock();
 		QInsertOnTail(msgSuspendQueueID, current);
 		msgSuspendUnlock();
+		traceEvent(TRACE_BLOCK, current, TRACE_REASON_MESSAGE);
+		setScheduleState(current, SCHED_STATE_MESSAGE);
 
 		msgUnlock();
 		dispatch();
@@ -542,3 +593,81 @@ void memoryPrint() {
 		++memoryPrints;
 	}
 }
+
+/**
+ * Takes the OS lock for the user interlock table.
+ * It waits until this thread holds the lock.
+ */
+void interlockLock() {
+	osLock(&osLocks[INTERLOCK_LOCK]);
+}
+
+/**
+ * Releases the OS lock for the user interlock table.
+ */
+void interlockUnlock() {
+	osUnlock(&osLocks[INTERLOCK_LOCK]);
+}
+
+/**
+ * Takes the OS lock for the buffer cache.
+ * It waits until this thread holds the lock.
+ */
+void cacheLock() {
+	osLock(&osLocks[CACHE_LOCK]);
+}
+
+/**
+ * Releases the OS lock for the buffer cache.
+ */
+void cacheUnlock() {
+	osUnlock(&osLocks[CACHE_LOCK]);
+}
+
+/**
+ * Takes the OS lock for the scheduling trace file.
+ * It waits until this thread holds the lock.
+ */
+void traceLock() {
+	osLock(&osLocks[TRACE_LOCK]);
+}
+
+/**
+ * Releases the OS lock for the scheduling trace file.
+ */
+void traceUnlock() {
+	osUnlock(&osLocks[TRACE_LOCK]);
+}
+
+/**
+ * Prints contention statistics for every OS lock,
+ * followed by the hardware's own locks.
+ * Can be called at any time.
+ */
+void printLockStats() {
+
+	aprintf("\nLock statistics\n");
+
+	for(int i = 0; i < NUM_OS_LOCKS; i++) {
+		printOsLockStats(&osLocks[i]);
+	}
+
+	printOsRwLockStats(&processTableLock);
+	printOsRwLockStats(&openFilesTableLock);
+
+	PrintHardwareLockStats();
+
+}
+
+/**
+ * Prints the OS's end of run reports,
+ * then halts the machine.
+ */
+void haltOS() {
+	printEdfReport();
+	flushTrace();
+	printLockStats();
+	printDiskStats();
+	printBufferCacheStats();
+	MEM_WRITE(Z502Halt, 0);
+}
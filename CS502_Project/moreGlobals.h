@@ -16,6 +16,7 @@
 #define INTERRUPT_PRINTS_LIMIT 10
 #define SYSNUM_MULTIDISPATCH 50
 #include "syscalls.h"
+#include "rbTree.h"
 
 //Struct for a process.
 //pid: the process ID.
@@ -27,6 +28,32 @@
 //currentDirectorySector: the sector of the disk containing the current directory.
 //currentDisk: the diskID containing the current directory
 //messagesSent: the number of messages sent by this process.
+//schedulingClass: which scheduling class the process belongs to.
+//period: the period of an EDF process.
+//relativeDeadline: how long after each release an EDF job must finish.
+//budget: the execution time an EDF job is expected to use each period.
+//releaseTime: the release time of the current EDF job.
+//absoluteDeadline: the hardware time the current EDF job must finish by.
+//edfJobs: the number of EDF jobs this process has completed.
+//deadlineMisses: the number of EDF jobs that finished after their deadline.
+//jobRuntime: the CPU time the current EDF job has used.
+//budgetOverruns: the number of times an EDF job used up its budget and was postponed.
+//vruntime: the weighted CPU time used, for the fair scheduling policy.
+//lastDispatchTime: the hardware time the process was last given the CPU.
+//readyNode: the process's node in the fair policy's ready tree.
+//processorSlot: the processor this process is running on in M mode, or -1.
+//lastProcessor: the processor this process last ran on in M mode, or -1.
+//readySinceDispatch: the dispatch count when this process was last made ready.
+//it has been passed over by every start on a processor since.
+//boost: the temporary priority boost left from waking up after I/O or a message.
+//boostRuntime: the CPU time run since the boost was given or last lost a level.
+//groupId: the process group this process belongs to. 0 means no group.
+//schedState: which state set the process is listed in, for schedule prints.
+//stateIndex: the process's position in that set.
+//inheritedPriority: the priority lent by processes waiting on interlocks this one holds, or -1.
+//waitingOnInterlock: the index of the interlock this process is waiting for, or -1.
+//terminatePending: 1 once another process has terminated this one while it ran
+//on another processor. it ends itself the next time it calls the OS or gives up its processor.
 struct Process {
 	long pid;
 	long priority;
@@ -38,6 +65,30 @@ struct Process {
 	int currentDirectorySector;
 	long currentDisk;
 	int messagesSent;
+	int schedulingClass;
+	long period;
+	long relativeDeadline;
+	long budget;
+	long releaseTime;
+	long absoluteDeadline;
+	long edfJobs;
+	long deadlineMisses;
+	long jobRuntime;
+	long budgetOverruns;
+	long vruntime;
+	long lastDispatchTime;
+	RBNode readyNode;
+	int processorSlot;
+	int lastProcessor;
+	long readySinceDispatch;
+	long boost;
+	long boostRuntime;
+	long groupId;
+	int schedState;
+	int stateIndex;
+	long inheritedPriority;
+	int waitingOnInterlock;
+	int terminatePending;
 };
 
 typedef struct Process Process;
@@ -67,10 +118,38 @@ struct Message {
 
 typedef struct Message Message;
 
+//struct for a request to read or write a disk sector.
+//diskID: the disk to use.
+//process: the process waiting for the request to finish, or -1 if none is yet.
+//mode: Z502DiskRead or Z502DiskWrite.
+//sector: the first sector to read or write.
+//count: how many consecutive sectors to read or write.
+//buffer: where the data comes from or goes to, for a single sector.
+//buffers: one buffer per sector. The request keeps its own copy of the list.
+//submitted: the time the request was made.
+//done: 1 once the disk has finished the request. 0 otherwise.
+//error: the status the disk finished the request with. ERR_SUCCESS unless the disk refused it.
+//tag: the tag the disk gave the request when it was started.
+//sequence: the order the request was made in, among all disk requests.
+//started: the time the request was given to the disk.
+//queuedIndex: its place in diskQueued while it waits in its disk's queue.
+//abandoned: 1 once its waiter has been terminated. whoever finishes it frees it.
 struct DiskRequest {
 	long diskID;
 	Process* process;
-	int currentlyUsing;
+	long mode;
+	long sector;
+	int count;
+	char* buffer;
+	char* buffers[MAX_DISK_IO_VECTOR];
+	long submitted;
+	int done;
+	long error;
+	long tag;
+	long sequence;
+	long started;
+	int queuedIndex;
+	int abandoned;
 };
 
 typedef struct DiskRequest DiskRequest;
@@ -90,6 +169,7 @@ int messageQueueID; //queue containing messages.
 int msgSuspendQueueID; //queue containing processes waiting for a message.
 
 int numProcessors;
+int bootProcessors; //how many processors to ask for in multiprocessor mode.
 
 int interruptPrints;
 int memoryPrints;
@@ -106,6 +186,8 @@ void suspendLock();
 void suspendUnlock();
 void processLock();
 void processUnlock();
+void processReadLock();
+void processReadUnlock();
 void msgSuspendLock();
 void msgSuspendUnlock();
 void diskContentsLock();
@@ -114,13 +196,25 @@ void readyLock();
 void readyUnlock();
 void openFilesLock();
 void openFilesUnlock();
+void openFilesReadLock();
+void openFilesReadUnlock();
 void memLock();
 void memUnlock();
 void swapLock();
 void swapUnlock();
+void stateLock();
+void stateUnlock();
+void interlockLock();
+void interlockUnlock();
+void cacheLock();
+void cacheUnlock();
+void traceLock();
+void traceUnlock();
+void printLockStats();
 long getTimeOfDay();
 void createTimerQueue();
 int addToTimerQueue(TimerRequest* request);
+void removeTimerRequest(Process* process);
 void interruptPrint(char msg[]);
 void initMessageQueue();
 void initMsgSuspendQueue();
@@ -128,5 +222,6 @@ long sendMessage(long targetPID, char* messageBuffer, long msgSendLength);
 long receiveMessage(long sourcePID, char* receiveBuffer, long receiveLength, long* sendLength, long* senderPid);
 void getNumProcessors();
 void memoryPrint();
+void haltOS();
 
 #endif /* MOREGLOBALS_H_ */
@@ -0,0 +1,393 @@
+/*
+ * osLock.c
+ *
+ *  Created on: Oct 21, 2019
+ *      Author: jean-philippe
+ */
+
+#include <sched.h>
+#include <time.h>
+#include <limits.h>
+#include "global.h"
+#include "protos.h"
+#include "osLock.h"
+
+#ifdef LINUX
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+//every thread has its own copy, so its address identifies the thread.
+static __thread char threadMarker;
+
+/**
+ * Returns a nonzero value unique to the calling thread.
+ */
+static uintptr_t selfId() {
+	return (uintptr_t)&threadMarker;
+}
+
+/**
+ * Returns the host's monotonic clock in nanoseconds.
+ * Locks are real host locks, so their waits are
+ * measured in real time rather than simulated time.
+ */
+static long lockClock() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/**
+ * Tries once to move the lock from free to held.
+ * Returns 1 if it succeeded, 0 otherwise.
+ */
+static int tryAcquire(OsLock* lock) {
+	int expected = OS_LOCK_FREE;
+	return atomic_compare_exchange_strong(&lock->state, &expected, OS_LOCK_HELD);
+}
+
+/**
+ * Records that this thread now holds the lock.
+ * Parameters:
+ * lock: the lock just taken.
+ * waitStart: when we started waiting for it, or -1 if we didn't wait.
+ */
+static void acquired(OsLock* lock, long waitStart) {
+
+	long now = lockClock();
+
+	atomic_store_explicit(&lock->owner, selfId(), memory_order_relaxed);
+	++lock->acquisitions;
+
+	if(waitStart != -1) {
+
+		long wait = now - waitStart;
+		++lock->contentions;
+		lock->totalWait += wait;
+
+		if(wait > lock->maxWait) {
+			lock->maxWait = wait;
+		}
+
+	}
+
+	lock->heldSince = now;
+
+}
+
+/**
+ * Sleeps until a lock word may no longer be
+ * the given value. May return early.
+ */
+static void waitWhile(atomic_int* word, int value) {
+#ifdef LINUX
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+#else
+	if(atomic_load(word) == value) {
+		sched_yield();
+	}
+#endif
+}
+
+/**
+ * Wakes up to count threads sleeping on a lock word.
+ */
+static void wake(atomic_int* word, int count) {
+#ifdef LINUX
+	syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#endif
+}
+
+/**
+ * Tries to take a lock without waiting.
+ * Parameters:
+ * lock: the lock to take.
+ * Returns 1 if this thread now holds the lock, 0 otherwise.
+ */
+int osTryLock(OsLock* lock) {
+
+	if(atomic_load_explicit(&lock->owner, memory_order_relaxed) == selfId()) {
+		return 1;
+	}
+
+	if(tryAcquire(lock)) {
+		acquired(lock, -1);
+		return 1;
+	}
+
+	return 0;
+
+}
+
+/**
+ * Takes a lock, waiting until it is free.
+ * Spins for a short while first, since OS locks
+ * are rarely held for long.
+ * Parameters:
+ * lock: the lock to take.
+ */
+void osLock(OsLock* lock) {
+
+	if(atomic_load_explicit(&lock->owner, memory_order_relaxed) == selfId()) {
+		return;
+	}
+
+	if(tryAcquire(lock)) {
+		acquired(lock, -1);
+		return;
+	}
+
+	long waitStart = lockClock();
+
+	for(int i = 0; i < OS_LOCK_SPIN_LIMIT; i++) {
+
+		sched_yield();
+
+		if(tryAcquire(lock)) {
+			acquired(lock, waitStart);
+			return;
+		}
+
+	}
+
+	//mark the lock contended so the holder knows to wake us.
+	//whoever takes it this way must also wake the next waiter,
+	//since we can't tell if anyone else is still sleeping.
+	while(atomic_exchange(&lock->state, OS_LOCK_CONTENDED) != OS_LOCK_FREE) {
+		waitWhile(&lock->state, OS_LOCK_CONTENDED);
+	}
+
+	acquired(lock, waitStart);
+
+}
+
+/**
+ * Releases a lock held by this thread.
+ * Does nothing if this thread doesn't hold it.
+ * Parameters:
+ * lock: the lock to release.
+ */
+void osUnlock(OsLock* lock) {
+
+	if(atomic_load_explicit(&lock->owner, memory_order_relaxed) != selfId()) {
+		return;
+	}
+
+	long hold = lockClock() - lock->heldSince;
+	lock->totalHold += hold;
+
+	if(hold > lock->maxHold) {
+		lock->maxHold = hold;
+	}
+
+	atomic_store_explicit(&lock->owner, 0, memory_order_relaxed);
+
+	if(atomic_exchange(&lock->state, OS_LOCK_FREE) == OS_LOCK_CONTENDED) {
+		wake(&lock->state, 1);
+	}
+
+}
+
+/**
+ * Prints a lock's statistics on one line.
+ * Times are shown in microseconds.
+ * Parameters:
+ * lock: the lock to print.
+ */
+void printOsLockStats(OsLock* lock) {
+
+	aprintf("Lock %-14s: acquired %7ld, contended %6ld, wait %8ld us (max %6ld), held %8ld us (max %6ld)\n",
+			lock->name, lock->acquisitions, lock->contentions,
+			lock->totalWait / 1000, lock->maxWait / 1000,
+			lock->totalHold / 1000, lock->maxHold / 1000);
+
+}
+
+/**
+ * Records that a reader-writer lock was taken,
+ * and how long we waited for it.
+ * Parameters:
+ * lock: the lock just taken.
+ * waitStart: when we started waiting for it, or -1 if we didn't wait.
+ */
+static void rwAcquired(OsRwLock* lock, long waitStart) {
+
+	if(waitStart == -1) {
+		return;
+	}
+
+	long wait = lockClock() - waitStart;
+	atomic_fetch_add(&lock->contentions, 1);
+	atomic_fetch_add(&lock->totalWait, wait);
+
+	long max = atomic_load(&lock->maxWait);
+	while(wait > max && !atomic_compare_exchange_weak(&lock->maxWait, &max, wait));
+
+}
+
+/**
+ * Waits for a reader-writer lock's state to change from
+ * what we last saw. Spins for a while before sleeping.
+ * Parameters:
+ * lock: the lock we're waiting on.
+ * seen: the state we last saw.
+ * attempt: how many times we've waited so far.
+ */
+static void rwWait(OsRwLock* lock, int seen, int attempt) {
+
+	if(attempt < OS_LOCK_SPIN_LIMIT) {
+		sched_yield();
+		return;
+	}
+
+	//count ourselves as a sleeper before sleeping, so whoever
+	//changes the state is sure to see us and wake us.
+	atomic_fetch_add(&lock->sleepers, 1);
+	waitWhile(&lock->state, seen);
+	atomic_fetch_sub(&lock->sleepers, 1);
+
+}
+
+/**
+ * Wakes every thread sleeping on a reader-writer lock.
+ */
+static void rwWakeAll(OsRwLock* lock) {
+
+	if(atomic_load(&lock->sleepers) > 0) {
+		wake(&lock->state, INT_MAX);
+	}
+
+}
+
+/**
+ * Takes the read side of a lock, waiting while
+ * a writer holds it or is waiting for it.
+ * Parameters:
+ * lock: the lock to take.
+ */
+void osReadLock(OsRwLock* lock) {
+
+	if(atomic_load_explicit(&lock->writer, memory_order_relaxed) == selfId()) {
+		return;
+	}
+
+	long waitStart = -1;
+
+	for(int attempt = 0; ; attempt++) {
+
+		int state = atomic_load(&lock->state);
+
+		if(state != OS_RWLOCK_WRITER && atomic_load(&lock->writersWaiting) == 0) {
+
+			if(atomic_compare_exchange_weak(&lock->state, &state, state + 1)) {
+				break;
+			}
+
+			continue;
+
+		}
+
+		if(waitStart == -1) {
+			waitStart = lockClock();
+		}
+
+		rwWait(lock, state, attempt);
+
+	}
+
+	atomic_fetch_add(&lock->reads, 1);
+	rwAcquired(lock, waitStart);
+
+}
+
+/**
+ * Releases the read side of a lock.
+ * Parameters:
+ * lock: the lock to release.
+ */
+void osReadUnlock(OsRwLock* lock) {
+
+	if(atomic_load_explicit(&lock->writer, memory_order_relaxed) == selfId()) {
+		return;
+	}
+
+	//the last reader out lets a waiting writer in.
+	if(atomic_fetch_sub(&lock->state, 1) == 1) {
+		rwWakeAll(lock);
+	}
+
+}
+
+/**
+ * Takes the write side of a lock, waiting
+ * until no reader or writer holds it.
+ * Does nothing if this thread already holds it.
+ * Parameters:
+ * lock: the lock to take.
+ */
+void osWriteLock(OsRwLock* lock) {
+
+	if(atomic_load_explicit(&lock->writer, memory_order_relaxed) == selfId()) {
+		return;
+	}
+
+	long waitStart = -1;
+	atomic_fetch_add(&lock->writersWaiting, 1);
+
+	for(int attempt = 0; ; attempt++) {
+
+		int state = 0;
+
+		if(atomic_compare_exchange_strong(&lock->state, &state, OS_RWLOCK_WRITER)) {
+			break;
+		}
+
+		if(waitStart == -1) {
+			waitStart = lockClock();
+		}
+
+		rwWait(lock, state, attempt);
+
+	}
+
+	atomic_fetch_sub(&lock->writersWaiting, 1);
+	atomic_store_explicit(&lock->writer, selfId(), memory_order_relaxed);
+	atomic_fetch_add(&lock->writes, 1);
+	rwAcquired(lock, waitStart);
+
+}
+
+/**
+ * Releases the write side of a lock.
+ * Does nothing if this thread doesn't hold it.
+ * Parameters:
+ * lock: the lock to release.
+ */
+void osWriteUnlock(OsRwLock* lock) {
+
+	if(atomic_load_explicit(&lock->writer, memory_order_relaxed) != selfId()) {
+		return;
+	}
+
+	atomic_store_explicit(&lock->writer, 0, memory_order_relaxed);
+	atomic_store(&lock->state, 0);
+	rwWakeAll(lock);
+
+}
+
+/**
+ * Prints a reader-writer lock's statistics on one line.
+ * Times are shown in microseconds.
+ * Parameters:
+ * lock: the lock to print.
+ */
+void printOsRwLockStats(OsRwLock* lock) {
+
+	aprintf("Lock %-14s: read %7ld, written %7ld, contended %6ld, wait %8ld us (max %6ld)\n",
+			lock->name, atomic_load(&lock->reads), atomic_load(&lock->writes),
+			atomic_load(&lock->contentions), atomic_load(&lock->totalWait) / 1000,
+			atomic_load(&lock->maxWait) / 1000);
+
+}
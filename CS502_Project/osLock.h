@@ -0,0 +1,95 @@
+/*
+ * osLock.h
+ *
+ *  Created on: Oct 21, 2019
+ *      Author: jean-philippe
+ */
+//intended to contain a native lock for the OS's own data structures.
+//it spins briefly, then sleeps in the kernel until the lock is free,
+//so taking an uncontended lock never goes through the simulated hardware.
+
+#ifndef OSLOCK_H_
+#define OSLOCK_H_
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+//how many times to retry a held lock before sleeping.
+#define OS_LOCK_SPIN_LIMIT 100
+
+//values of an OsLock's state.
+#define OS_LOCK_FREE 0
+#define OS_LOCK_HELD 1
+#define OS_LOCK_CONTENDED 2 //held, and someone may be sleeping on it.
+
+//struct for a native OS lock.
+//state: OS_LOCK_FREE, OS_LOCK_HELD or OS_LOCK_CONTENDED.
+//owner: identifies the thread holding the lock. 0 if free.
+//name: what the lock guards, for printing its statistics.
+//acquisitions: how many times the lock has been taken.
+//contentions: how many of those had to wait for another holder.
+//totalWait, maxWait: time spent waiting for the lock, in nanoseconds.
+//totalHold, maxHold: time the lock was held, in nanoseconds.
+//heldSince: when the current holder took the lock.
+//the statistics are only written by the holder.
+//a zeroed OsLock is free, so static locks need no setup.
+//like the hardware interlocks these replace, locking a lock
+//you already hold does nothing, and only the owner can unlock it.
+struct OsLock {
+	atomic_int state;
+	atomic_uintptr_t owner;
+	char* name;
+	long acquisitions;
+	long contentions;
+	long totalWait;
+	long maxWait;
+	long totalHold;
+	long maxHold;
+	long heldSince;
+};
+
+typedef struct OsLock OsLock;
+
+//values of an OsRwLock's state, other than a count of readers.
+#define OS_RWLOCK_WRITER -1
+
+//struct for a native reader-writer lock.
+//any number of readers can hold it at once, or one writer.
+//once a writer is waiting, new readers wait behind it,
+//so a steady stream of lookups can't starve writers.
+//state: the number of readers holding the lock, or OS_RWLOCK_WRITER.
+//writersWaiting: how many writers are waiting for the lock.
+//sleepers: how many threads are asleep waiting for state to change.
+//writer: identifies the thread holding it for writing. 0 if none.
+//name: what the lock guards, for printing its statistics.
+//reads, writes: how many times it has been taken each way.
+//contentions: how many of those had to wait.
+//totalWait, maxWait: time spent waiting for the lock, in nanoseconds.
+//a thread holding the write side may also take the read side;
+//both are then no-ops. a zeroed OsRwLock is free.
+struct OsRwLock {
+	atomic_int state;
+	atomic_int writersWaiting;
+	atomic_int sleepers;
+	atomic_uintptr_t writer;
+	char* name;
+	atomic_long reads;
+	atomic_long writes;
+	atomic_long contentions;
+	atomic_long totalWait;
+	atomic_long maxWait;
+};
+
+typedef struct OsRwLock OsRwLock;
+
+void osLock(OsLock* lock);
+int osTryLock(OsLock* lock);
+void osUnlock(OsLock* lock);
+void printOsLockStats(OsLock* lock);
+void osReadLock(OsRwLock* lock);
+void osReadUnlock(OsRwLock* lock);
+void osWriteLock(OsRwLock* lock);
+void osWriteUnlock(OsRwLock* lock);
+void printOsRwLockStats(OsRwLock* lock);
+
+#endif /* OSLOCK_H_ */
@@ -16,6 +16,8 @@
 #include "memoryManager.h"
 #include "moreGlobals.h"
 #include "fileSystem.h"
+#include "schedTrace.h"
+#include "interlockManager.h"
 
 void storeProcess(Process* process);
 
@@ -23,9 +25,17 @@ void storeProcess(Process* process);
 
 Process* processes; //a dynamically allocated array that will store created processes.
 
+int liveContexts = 0;
+//the hardware has a thread for each context, and only so many threads.
+//a terminated process's context is destroyed to give its thread back.
+
+int retiredContextQueueID;
+//terminated processes whose contexts are still to be destroyed.
+
 long currPidNumber = 1;
 //the pid of a process is decided by a number sequence.
-//we get the next number in the sequence by incrementing currPidNumber.
+//we get the next number in the sequence by incrementing currPidNumber,
+//holding the process lock.
 
 /**
  * This does all initial work needed for starting
@@ -41,6 +51,7 @@ void pcbInit(long address, long pageTable) {
 	schedulePrintLimit = 50;
 	processes = (Process *)calloc(MAX_PROCESSES, sizeof(Process));
 	processQueueID = QCreate("processQ");
+	retiredContextQueueID = QCreate("retiredQ");
 	createTimerQueue();
 
 	if(timerQueueID == -1) {
@@ -68,6 +79,7 @@ void pcbInit(long address, long pageTable) {
 	initMsgSuspendQueue();
 	initMemoryManager();
 	initFileSystem();
+	initInterlocks();
 	getNumProcessors();
 
 	//if this is multiprocessed,
@@ -81,10 +93,12 @@ void pcbInit(long address, long pageTable) {
 		mmio.Field2 = (long)startMultidispatcher;
 		mmio.Field3 = (long)calloc(2, NUMBER_VIRTUAL_PAGES );
 		MEM_WRITE(Z502Context, &mmio);
+		++liveContexts;
 
 		//start it up in the background.
 		mmio.Mode = Z502StartContext;
 		mmio.Field2 = START_NEW_CONTEXT_ONLY;
+		mmio.Field3 = 0;
 		MEM_WRITE(Z502Context, &mmio);
 
 	}
@@ -110,7 +124,7 @@ void createInitialProcess(long address, long pageTable) {
 	Process* process = (Process*)malloc(sizeof(Process));
 	process->name = ""; //current process's name is ""
 	process->priority = 10;
-	process->pid =  currPidNumber;
+	process->pid =  currPidNumber++;
 	process->startingAddress = address;
 	process->pageTable = (UINT16*)pageTable;
 	process->swapTable = (int*)calloc(1024, sizeof(int));
@@ -119,6 +133,8 @@ void createInitialProcess(long address, long pageTable) {
 		process->swapTable[i] = -1;
 	}
 
+	initSchedulingInfo(process);
+
 	//start the process by initializing then starting context.
 	MEMORY_MAPPED_IO mmio;
 	mmio.Mode = Z502InitializeContext;
@@ -137,12 +153,21 @@ void createInitialProcess(long address, long pageTable) {
 	process->contextId = mmio.Field1;
 	process->currentDirectorySector = -1;
 	process->messagesSent = 0;
+	++liveContexts;
 
 	storeProcess(process);
 
+	//the first process takes a processor before the multidispatcher can.
+	if(numProcessors > 1) {
+		readyLock();
+		claimProcessor(process, 0);
+		readyUnlock();
+	}
+
 	mmio.Mode = Z502StartContext;
 	// Field1 contains the value of the context returned in the last call
 	mmio.Field2 = START_NEW_CONTEXT_AND_SUSPEND;
+	mmio.Field3 = 0;
 	MEM_WRITE(Z502Context, &mmio);     // Start up the context
 
 	//check that this call was successful
@@ -179,13 +204,13 @@ long getPid(char* name) {
 		return current->pid;
 	}
 
-	processLock();
+	processReadLock();
 	int i = 0;
 	Process* proc = (Process *)QWalk(processQueueID,i);
 	do {
 
 		if(strcmp(name, proc->name) == 0) {
-			processUnlock();
+			processReadUnlock();
 			return proc->pid;
 		}
 
@@ -193,7 +218,7 @@ long getPid(char* name) {
 		proc = (Process *)QWalk(processQueueID,i);
 
 	} while((int)proc != -1);
-	processUnlock();
+	processReadUnlock();
 
 	//we didn't find the process. return error message.
 	return -1;
@@ -209,7 +234,7 @@ long getPid(char* name) {
  */
 Process* getProcess(long pid) {
 
-	processLock();
+	processReadLock();
 	int i = 0;
 	Process* proc = (Process *)QWalk(processQueueID,i);
 
@@ -217,7 +242,7 @@ Process* getProcess(long pid) {
 	do {
 
 		if(pid == proc->pid) {
-			processUnlock();
+			processReadUnlock();
 			return proc;
 		}
 
@@ -225,7 +250,7 @@ Process* getProcess(long pid) {
 		proc = (Process *)QWalk(processQueueID,i);
 
 	} while((int)proc != -1);
-	processUnlock();
+	processReadUnlock();
 
 	//process wasn't found. return -1;
 	return (Process*)-1;
@@ -247,6 +272,8 @@ void startTimer(long timeAmount) {
 	Process* curr = currentProcess();
 	request->process = curr;
 	request->sleepUntil = getTimeOfDay() + timeAmount;
+	traceEvent(TRACE_BLOCK, curr, TRACE_REASON_SLEEP);
+	setScheduleState(curr, SCHED_STATE_TIMER);
 
 	//place on timer queue.
 	int result = addToTimerQueue(request);
@@ -292,7 +319,7 @@ Process* currentProcess() {
 
 	//find the process with this context by iterating through
 	//process queue.
-	processLock();
+	processReadLock();
 	int i =0;
 	Process* proc;
 	do {
@@ -302,14 +329,14 @@ Process* currentProcess() {
 		if((int)proc == -1) break;
 
 		if(proc->contextId == contextId) {
-			processUnlock();
+			processReadUnlock();
 			return proc;
 		}
 
 		++i;
 
 	} while((int)proc != -1);
-	processUnlock();
+	processReadUnlock();
 
 	return (Process*)-1;
 
@@ -317,15 +344,12 @@ Process* currentProcess() {
 
 /**
  * Stores a process in the processes array and
- * updates the pid sequence and current
- * number of processes.
+ * updates the current number of processes.
  */
 void storeProcess(Process* process) {
 	//processes[numProcesses] = process;
 
-	//update number of processes and the next pid in the sequence.
-	++currPidNumber;
-
+	//update number of processes.
 	processLock();
 	++numProcesses;
 	QInsertOnTail(processQueueID,process);
@@ -342,13 +366,18 @@ void storeProcess(Process* process) {
  * Returns 0 if creating the process was successful.
  * Returns -1 if an error occurs.
  */
-long createProcess(char* processName, void* startingAddress, long initialPriority, long* pid) {
+long createProcess(char* processName, void* startingAddress, long initialPriority, long groupId, long* pid) {
 
 	//process can't have an illegal priority
 	if(initialPriority < 0) {
 		return -1;
 	}
 
+	//nor an illegal group.
+	if(groupId < 0) {
+		return -1;
+	}
+
 	//process can't have the same name as another process.
 	if(getPid(processName) != -1) {
 		return -1;
@@ -359,18 +388,36 @@ long createProcess(char* processName, void* startingAddress, long initialPriorit
 		return -1;
 	}
 
+	//give back the threads of processes that have terminated.
+	destroyRetiredContexts();
+
+	//nor can we make more contexts than the hardware has threads.
+	//the multidispatcher has a context of its own, so this can
+	//only run out in multiprocessor mode.
+	if(numProcessors > 1 && liveContexts >= MAX_NUMBER_OF_USER_THREADS) {
+		return -1;
+	}
+
 	Process* process = (Process*)malloc(sizeof(Process));
-	process->name = calloc(strlen(processName),sizeof(char));
+	process->name = calloc(strlen(processName) + 1, sizeof(char));
 	strcpy(process->name,processName);
 	process->startingAddress = (long)startingAddress;
 	process->priority = initialPriority;
-	process->pid = currPidNumber;
+
+	//processes on other processors may be getting pids at the same time.
+	processLock();
+	process->pid = currPidNumber++;
+	processUnlock();
+
 	process->swapTable = (int*)calloc(1024, sizeof(int));
 
 	for(int i = 0; i<1024; i++) {
 		process->swapTable[i] = -1;
 	}
 
+	initSchedulingInfo(process);
+	process->groupId = groupId;
+
 	void *pageTable = (void *) calloc(2, NUMBER_VIRTUAL_PAGES );
 	process->pageTable = pageTable;
 
@@ -392,6 +439,7 @@ long createProcess(char* processName, void* startingAddress, long initialPriorit
 	process->currentDirectorySector = -1;
 	process->contextId = mmio.Field1;
 	process->messagesSent = 0;
+	++liveContexts;
 
 	storeProcess(process);
 
@@ -399,6 +447,51 @@ long createProcess(char* processName, void* startingAddress, long initialPriorit
 	return process->pid;
 }
 
+/**
+ * Marks a terminated process's context to be destroyed.
+ * A process can't destroy its own context, so this is put
+ * off until the next process is created.
+ * Parameters:
+ * process: the process that has terminated.
+ */
+void retireContext(Process* process) {
+
+	processLock();
+	QInsertOnTail(retiredContextQueueID, process);
+	processUnlock();
+
+}
+
+/**
+ * Destroys the contexts of terminated processes,
+ * so the hardware can use their threads again.
+ */
+void destroyRetiredContexts() {
+
+	processLock();
+	Process* process = (Process*)QRemoveHead(retiredContextQueueID);
+
+	while((int)process != -1) {
+
+		MEMORY_MAPPED_IO mmio;
+		mmio.Mode = Z502DestroyContext;
+		mmio.Field1 = process->contextId;
+		mmio.Field2 = 0;
+		mmio.Field3 = 0;
+		mmio.Field4 = 0;
+		MEM_WRITE(Z502Context, &mmio);
+
+		if(mmio.Field4 == ERR_SUCCESS) {
+			--liveContexts;
+		}
+
+		process = (Process*)QRemoveHead(retiredContextQueueID);
+
+	}
+	processUnlock();
+
+}
+
 /**
  * Changes the priority of a certain process
  * to a new priority.
@@ -427,20 +520,11 @@ long changePriority(long pid, long newPriority) {
 		return -1;
 	}
 
-	process->priority = newPriority;
-
-	readyLock();
 	//the process must go to a new position in the ready queue
 	//since it has a new priority.
-	if((int)QItemExists(readyQueueId,process) != -1) {
-
-
-		QRemoveItem(readyQueueId,process);
-
-
-		addToReadyQueue(process);
-
-	}
+	readyLock();
+	process->priority = newPriority;
+	requeueReady(process);
 	readyUnlock();
 
 	return 0;
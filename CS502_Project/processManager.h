@@ -16,9 +16,11 @@ void startTimer(long timeAmount);
 Process* currentProcess();
 void createInitialProcess(long address, long pageTable);
 void idle();
-long createProcess(char* processName, void* startingAddress, long initialPriority, long* pid);
+long createProcess(char* processName, void* startingAddress, long initialPriority, long groupId, long* pid);
 Process* getProcess(long pid);
 long changePriority(long pid, long newPriority);
+void retireContext(Process* process);
+void destroyRetiredContexts();
 
 
 int timerQueueID;
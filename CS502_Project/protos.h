@@ -91,6 +91,18 @@ void   test45( void );
 void   test46( void );
 void   test47( void );
 void   test48( void );
+void   test50( void );
+void   test51( void );
+void   test52( void );
+void   test53( void );
+void   test54( void );
+void   test55( void );
+void   test56( void );
+void   test57( void );
+void   test58( void );
+void   test59( void );
+void   test60( void );
+void   test61( void );
 
 void   GetSkewedRandomNumber( long*, long, long );   // Used by sample.c
 
@@ -110,5 +122,6 @@ void   Z502ReadPhysicalMemory( INT32, char *);
 void   Z502WritePhysicalMemory( INT32, char *);
 void   *Z502PrepareProcessForExecution( void );
 void   Z502MemoryReadModify( INT32, INT32, INT32, INT32 * );
+void   PrintHardwareLockStats( void );
 
 #endif // PROTOS_H_
@@ -0,0 +1,386 @@
+/*
+ * rbTree.c
+ *
+ *  Created on: Oct 18, 2019
+ *      Author: jean-philippe
+ */
+
+#include <stdlib.h>
+#include "rbTree.h"
+
+/**
+ * Returns the color of a node.
+ * Missing (NULL) nodes count as black.
+ */
+static int colorOf(RBNode* node) {
+	return node == NULL ? RB_BLACK : node->color;
+}
+
+/**
+ * Makes a tree empty.
+ * Parameters:
+ * tree: the tree to initialize.
+ */
+void rbInit(RBTree* tree) {
+	tree->root = NULL;
+	tree->count = 0;
+}
+
+/**
+ * Rotates the subtree at node to the left,
+ * making node's right child its parent.
+ */
+static void rotateLeft(RBTree* tree, RBNode* node) {
+
+	RBNode* right = node->right;
+
+	node->right = right->left;
+	if(right->left != NULL) {
+		right->left->parent = node;
+	}
+
+	right->parent = node->parent;
+
+	if(node->parent == NULL) {
+		tree->root = right;
+	} else if(node == node->parent->left) {
+		node->parent->left = right;
+	} else {
+		node->parent->right = right;
+	}
+
+	right->left = node;
+	node->parent = right;
+
+}
+
+/**
+ * Rotates the subtree at node to the right,
+ * making node's left child its parent.
+ */
+static void rotateRight(RBTree* tree, RBNode* node) {
+
+	RBNode* left = node->left;
+
+	node->left = left->right;
+	if(left->right != NULL) {
+		left->right->parent = node;
+	}
+
+	left->parent = node->parent;
+
+	if(node->parent == NULL) {
+		tree->root = left;
+	} else if(node == node->parent->right) {
+		node->parent->right = left;
+	} else {
+		node->parent->left = left;
+	}
+
+	left->right = node;
+	node->parent = left;
+
+}
+
+/**
+ * Inserts a node into the tree.
+ * Nodes with equal keys are kept in insertion order.
+ * Parameters:
+ * tree: the tree to insert into.
+ * node: the node to insert. It must not already be in a tree.
+ * key: the value to order the node by.
+ * item: the item the node belongs to.
+ */
+void rbInsert(RBTree* tree, RBNode* node, long key, void* item) {
+
+	node->key = key;
+	node->item = item;
+	node->left = NULL;
+	node->right = NULL;
+	node->color = RB_RED;
+	node->inTree = 1;
+
+	//ordinary binary search tree insertion first.
+	RBNode* parent = NULL;
+	RBNode* curr = tree->root;
+
+	while(curr != NULL) {
+		parent = curr;
+		if(key < curr->key) {
+			curr = curr->left;
+		} else {
+			curr = curr->right;
+		}
+	}
+
+	node->parent = parent;
+
+	if(parent == NULL) {
+		tree->root = node;
+	} else if(key < parent->key) {
+		parent->left = node;
+	} else {
+		parent->right = node;
+	}
+
+	++tree->count;
+
+	//now fix any red node with a red parent.
+	while(node != tree->root && colorOf(node->parent) == RB_RED) {
+
+		RBNode* grandparent = node->parent->parent;
+
+		if(node->parent == grandparent->left) {
+
+			RBNode* uncle = grandparent->right;
+
+			if(colorOf(uncle) == RB_RED) {
+				node->parent->color = RB_BLACK;
+				uncle->color = RB_BLACK;
+				grandparent->color = RB_RED;
+				node = grandparent;
+			} else {
+				if(node == node->parent->right) {
+					node = node->parent;
+					rotateLeft(tree, node);
+				}
+				node->parent->color = RB_BLACK;
+				grandparent->color = RB_RED;
+				rotateRight(tree, grandparent);
+			}
+
+		} else {
+
+			RBNode* uncle = grandparent->left;
+
+			if(colorOf(uncle) == RB_RED) {
+				node->parent->color = RB_BLACK;
+				uncle->color = RB_BLACK;
+				grandparent->color = RB_RED;
+				node = grandparent;
+			} else {
+				if(node == node->parent->left) {
+					node = node->parent;
+					rotateRight(tree, node);
+				}
+				node->parent->color = RB_BLACK;
+				grandparent->color = RB_RED;
+				rotateLeft(tree, grandparent);
+			}
+
+		}
+
+	}
+
+	tree->root->color = RB_BLACK;
+
+}
+
+/**
+ * Puts replacement where node was in the tree.
+ * replacement may be NULL.
+ */
+static void transplant(RBTree* tree, RBNode* node, RBNode* replacement) {
+
+	if(node->parent == NULL) {
+		tree->root = replacement;
+	} else if(node == node->parent->left) {
+		node->parent->left = replacement;
+	} else {
+		node->parent->right = replacement;
+	}
+
+	if(replacement != NULL) {
+		replacement->parent = node->parent;
+	}
+
+}
+
+/**
+ * Returns the node with the smallest key in a subtree.
+ */
+static RBNode* minimum(RBNode* node) {
+
+	while(node->left != NULL) {
+		node = node->left;
+	}
+
+	return node;
+
+}
+
+/**
+ * Restores the red-black properties after a black
+ * node was removed from above child. Since child
+ * may be NULL, its parent is passed separately.
+ */
+static void removeFixup(RBTree* tree, RBNode* child, RBNode* parent) {
+
+	while(child != tree->root && colorOf(child) == RB_BLACK) {
+
+		if(child == parent->left) {
+
+			RBNode* sibling = parent->right;
+
+			if(colorOf(sibling) == RB_RED) {
+				sibling->color = RB_BLACK;
+				parent->color = RB_RED;
+				rotateLeft(tree, parent);
+				sibling = parent->right;
+			}
+
+			if(colorOf(sibling->left) == RB_BLACK && colorOf(sibling->right) == RB_BLACK) {
+				sibling->color = RB_RED;
+				child = parent;
+				parent = child->parent;
+			} else {
+				if(colorOf(sibling->right) == RB_BLACK) {
+					sibling->left->color = RB_BLACK;
+					sibling->color = RB_RED;
+					rotateRight(tree, sibling);
+					sibling = parent->right;
+				}
+				sibling->color = parent->color;
+				parent->color = RB_BLACK;
+				sibling->right->color = RB_BLACK;
+				rotateLeft(tree, parent);
+				child = tree->root;
+			}
+
+		} else {
+
+			RBNode* sibling = parent->left;
+
+			if(colorOf(sibling) == RB_RED) {
+				sibling->color = RB_BLACK;
+				parent->color = RB_RED;
+				rotateRight(tree, parent);
+				sibling = parent->left;
+			}
+
+			if(colorOf(sibling->left) == RB_BLACK && colorOf(sibling->right) == RB_BLACK) {
+				sibling->color = RB_RED;
+				child = parent;
+				parent = child->parent;
+			} else {
+				if(colorOf(sibling->left) == RB_BLACK) {
+					sibling->right->color = RB_BLACK;
+					sibling->color = RB_RED;
+					rotateLeft(tree, sibling);
+					sibling = parent->left;
+				}
+				sibling->color = parent->color;
+				parent->color = RB_BLACK;
+				sibling->left->color = RB_BLACK;
+				rotateRight(tree, parent);
+				child = tree->root;
+			}
+
+		}
+
+	}
+
+	if(child != NULL) {
+		child->color = RB_BLACK;
+	}
+
+}
+
+/**
+ * Removes a node from the tree.
+ * Does nothing if the node isn't in a tree.
+ * Parameters:
+ * tree: the tree containing the node.
+ * node: the node to remove.
+ */
+void rbRemove(RBTree* tree, RBNode* node) {
+
+	if(!node->inTree) {
+		return;
+	}
+
+	RBNode* child;
+	RBNode* childParent;
+	int removedColor = node->color;
+
+	if(node->left == NULL) {
+
+		child = node->right;
+		childParent = node->parent;
+		transplant(tree, node, node->right);
+
+	} else if(node->right == NULL) {
+
+		child = node->left;
+		childParent = node->parent;
+		transplant(tree, node, node->left);
+
+	} else {
+
+		//two children: the successor takes node's place.
+		RBNode* successor = minimum(node->right);
+		removedColor = successor->color;
+		child = successor->right;
+
+		if(successor->parent == node) {
+			childParent = successor;
+		} else {
+			childParent = successor->parent;
+			transplant(tree, successor, successor->right);
+			successor->right = node->right;
+			successor->right->parent = successor;
+		}
+
+		transplant(tree, node, successor);
+		successor->left = node->left;
+		successor->left->parent = successor;
+		successor->color = node->color;
+
+	}
+
+	if(removedColor == RB_BLACK) {
+		removeFixup(tree, child, childParent);
+	}
+
+	node->inTree = 0;
+	node->left = NULL;
+	node->right = NULL;
+	node->parent = NULL;
+	--tree->count;
+
+}
+
+/**
+ * Returns the node with the smallest key,
+ * or NULL if the tree is empty.
+ */
+RBNode* rbFirst(RBTree* tree) {
+
+	if(tree->root == NULL) {
+		return NULL;
+	}
+
+	return minimum(tree->root);
+
+}
+
+/**
+ * Returns the node following this one in key order,
+ * or NULL if this is the last node.
+ */
+RBNode* rbNext(RBNode* node) {
+
+	if(node->right != NULL) {
+		return minimum(node->right);
+	}
+
+	RBNode* parent = node->parent;
+
+	while(parent != NULL && node == parent->right) {
+		node = parent;
+		parent = parent->parent;
+	}
+
+	return parent;
+
+}
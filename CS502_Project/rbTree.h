@@ -0,0 +1,52 @@
+/*
+ * rbTree.h
+ *
+ *  Created on: Oct 18, 2019
+ *      Author: jean-philippe
+ */
+//intended to contain a red-black tree for keeping
+//items ordered by a key with O(log n) insert and removal.
+//nodes are embedded in the items themselves, so the tree
+//never allocates memory.
+
+#ifndef RBTREE_H_
+#define RBTREE_H_
+
+#define RB_RED 0
+#define RB_BLACK 1
+
+//struct for a node of a red-black tree.
+//key: the value the tree is ordered by.
+//item: the item this node belongs to.
+//color: RB_RED or RB_BLACK.
+//left, right, parent: the node's neighbours in the tree.
+//inTree: 1 if the node is currently in a tree. 0 otherwise.
+struct RBNode {
+	long key;
+	void* item;
+	int color;
+	struct RBNode* left;
+	struct RBNode* right;
+	struct RBNode* parent;
+	int inTree;
+};
+
+typedef struct RBNode RBNode;
+
+//struct for a red-black tree.
+//root: the root of the tree, or NULL if empty.
+//count: the number of nodes in the tree.
+struct RBTree {
+	RBNode* root;
+	int count;
+};
+
+typedef struct RBTree RBTree;
+
+void rbInit(RBTree* tree);
+void rbInsert(RBTree* tree, RBNode* node, long key, void* item);
+void rbRemove(RBTree* tree, RBNode* node);
+RBNode* rbFirst(RBTree* tree);
+RBNode* rbNext(RBNode* node);
+
+#endif /* RBTREE_H_ */
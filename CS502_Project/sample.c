@@ -472,49 +472,49 @@ void SampleCode(void) {
 
 	printf(
 			"1.  Start State = Unlocked:  Action (Thread 1) = Lock: End State = Locked\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_LOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_LOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
 	printf(
 			"2.  Start State = locked(1): Action (Thread 1) = unLock: End State = UnLocked\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
 	printf(
 			"3.  Start State = Unlocked:  Action (Thread 1) = unLock: End State = UnLocked\n");
 	printf("    An Error is Expected\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
 	printf(
 			"4.  Start State = unlocked:  Action (Thread 1) = tryLock: End State = Locked\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
 	printf(
 			"5.  Start State = Locked(1): Action (Thread 1) = tryLock: End State = Locked\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
 	printf(
 			"6.  Start State = locked(1): Action (Thread 1) = unLock: End State = UnLocked\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
 	printf(
 			"7.  Start State = Unlocked:  Action (Thread 1) = Lock: End State = Locked\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_LOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_LOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
 	//  A thread that locks an item it has already locked will succeed
 	printf(
 			"8.  Start State = locked(1): Action (Thread 1) = Lock: End State = Locked\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_LOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_LOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
@@ -545,7 +545,7 @@ void SampleCode(void) {
 	//  the lock so there is a "relock" when thread two succeeds.
 	printf(
 			"12. Start State = locked(1): Action (Thread 1) = unLock: End State = Locked(by 2)\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 	DoASleep(100); /*  Wait for locking action of 2nd thread to finish   */
@@ -558,13 +558,13 @@ void SampleCode(void) {
 
 	printf(
 			"14. Start State = Locked(2): Action (Thread 1) = tryLock: End State = Locked(2)\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
 	printf(
 			"15. Start State = locked(2): Action (Thread 1) = unLock: End State = Locked(2)\n");
 	printf("    An Error is Expected\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("%s\n", &(Success[SPART * LockResult]));
 
@@ -666,20 +666,20 @@ void starting_point_for_new_context(void) {
 void DoOnelock(void) {
 	INT32 LockResult;
 	printf("      Thread 2 - about to do a lock\n");
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_LOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_LOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("      Thread 2 Lock:  %s\n", &(Success[SPART * LockResult]));
 //    DestroyThread( 0 );
 }
 void DoOneTrylock(void) {
 	INT32 LockResult;
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
 	printf("      Thread 2 TryLock:  %s\n", &(Success[SPART * LockResult]));
 //    DestroyThread( 0 );
 }
 void DoOneUnlock(void) {
 	INT32 LockResult;
-	READ_MODIFY(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
+	Z502MemoryReadModify(MEMORY_INTERLOCK_BASE, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
 	printf("      Thread 2 UnLock:  %s\n", &(Success[SPART * LockResult]));
 //    DestroyThread( 0 );
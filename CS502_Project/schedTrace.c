@@ -0,0 +1,235 @@
+/*
+ * schedTrace.c
+ *
+ *  Created on: Oct 20, 2019
+ *      Author: jean-philippe
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "global.h"
+#include "syscalls.h"
+#include "protos.h"
+#include "moreGlobals.h"
+#include "schedTrace.h"
+
+//the number of events each buffer can hold.
+//a full buffer is written to the trace file and reused.
+#define TRACE_BUFFER_RECORDS 8192
+
+//one buffer per processor, plus one for the interrupt handler.
+#define TRACE_NUM_BUFFERS (MAX_NUMBER_OF_PROCESSORS + 1)
+#define TRACE_INTERRUPT_BUFFER MAX_NUMBER_OF_PROCESSORS
+
+TraceRecord* traceBuffers[TRACE_NUM_BUFFERS];
+
+//how many records have been claimed in each buffer.
+//claims are atomic, so writers on different threads
+//never need a lock to share a buffer.
+int traceCounts[TRACE_NUM_BUFFERS];
+
+//how many of the claimed records in each buffer have been filled in.
+int traceFilled[TRACE_NUM_BUFFERS];
+
+uint32_t traceSequence = 0; //records claimed so far, in every buffer.
+uint32_t traceWritten = 0; //records already in the trace file.
+int traceDropped = 0; //events lost because the file couldn't take them.
+char* traceFileName;
+FILE* traceFile;
+
+/**
+ * Turns on tracing of scheduling events.
+ * The trace file is opened now, since full
+ * buffers are written to it as the OS runs.
+ * Parameters:
+ * fileName: where the trace is written.
+ */
+void initTrace(char* fileName) {
+
+	traceFile = fopen(fileName, "wb");
+
+	if(traceFile == NULL) {
+		aprintf("Could not open trace file %s\n", fileName);
+		return;
+	}
+
+	//the header is filled in when the trace is flushed.
+	TraceHeader header;
+	memset(&header, 0, sizeof(TraceHeader));
+	fwrite(&header, sizeof(TraceHeader), 1, traceFile);
+
+	for(int i = 0; i < TRACE_NUM_BUFFERS; i++) {
+		traceBuffers[i] = (TraceRecord*)calloc(TRACE_BUFFER_RECORDS, sizeof(TraceRecord));
+		traceCounts[i] = 0;
+		traceFilled[i] = 0;
+	}
+
+	traceFileName = fileName;
+	traceEnabled = 1;
+
+}
+
+/**
+ * Appends the first count records of a buffer to the trace file.
+ * The caller must hold the trace lock.
+ */
+static void writeBuffer(int buffer, int count) {
+
+	//wait for writers still filling in records they claimed.
+	while(__sync_fetch_and_add(&traceFilled[buffer], 0) < count) {
+	}
+
+	int written = fwrite(traceBuffers[buffer], sizeof(TraceRecord), count, traceFile);
+	traceWritten += written;
+	traceDropped += count - written;
+
+}
+
+/**
+ * Writes out a full buffer and empties it, so the
+ * events that didn't fit can be recorded.
+ * Parameters:
+ * buffer: the full buffer.
+ */
+static void spillBuffer(int buffer) {
+
+	traceLock();
+
+	//whoever got here first may already have emptied it.
+	if(__sync_fetch_and_add(&traceCounts[buffer], 0) >= TRACE_BUFFER_RECORDS) {
+
+		//once the trace is flushed there's no file to write to.
+		if(traceEnabled) {
+			writeBuffer(buffer, TRACE_BUFFER_RECORDS);
+		}
+
+		traceFilled[buffer] = 0;
+		__sync_synchronize();
+		traceCounts[buffer] = 0;
+
+	}
+
+	traceUnlock();
+
+}
+
+/**
+ * Records an event in a given buffer.
+ * Parameters:
+ * buffer: the buffer to write to.
+ * processor: the processor id to stamp the event with.
+ * type: the kind of event.
+ * pid: the process the event is about.
+ * arg: extra information for the event.
+ */
+static void writeRecord(int buffer, int processor, int type, long pid, long arg) {
+
+	//read the clock first, so a claimed record is filled in quickly.
+	int32_t time = (int32_t)getTimeOfDay();
+
+	int index = __sync_fetch_and_add(&traceCounts[buffer], 1);
+
+	while(index >= TRACE_BUFFER_RECORDS) {
+		spillBuffer(buffer);
+		index = __sync_fetch_and_add(&traceCounts[buffer], 1);
+	}
+
+	TraceRecord* record = &traceBuffers[buffer][index];
+	record->time = time;
+	record->processor = (int16_t)processor;
+	record->type = (int16_t)type;
+	record->pid = (int32_t)pid;
+	record->arg = (int32_t)arg;
+	record->seq = __sync_fetch_and_add(&traceSequence, 1);
+
+	__sync_fetch_and_add(&traceFilled[buffer], 1);
+
+}
+
+/**
+ * Records a scheduling event about a process, on the
+ * processor the process is running on or last ran on.
+ * Parameters:
+ * type: the kind of event.
+ * process: the process the event is about.
+ * arg: extra information for the event.
+ */
+void traceEvent(int type, Process* process, long arg) {
+
+	if(!traceEnabled) {
+		return;
+	}
+
+	int processor = process->processorSlot;
+
+	if(processor == -1) {
+		processor = process->lastProcessor;
+	}
+
+	if(processor < 0 || processor >= MAX_NUMBER_OF_PROCESSORS) {
+		processor = 0;
+	}
+
+	writeRecord(processor, processor, type, process->pid, arg);
+
+}
+
+/**
+ * Records a scheduling event raised by the interrupt handler.
+ * Parameters:
+ * type: the kind of event.
+ * process: the process the event is about.
+ * arg: extra information for the event.
+ */
+void traceInterruptEvent(int type, Process* process, long arg) {
+
+	if(!traceEnabled) {
+		return;
+	}
+
+	writeRecord(TRACE_INTERRUPT_BUFFER, TRACE_INTERRUPT_PROCESSOR, type, process->pid, arg);
+
+}
+
+/**
+ * Writes the events still buffered to the trace file,
+ * then fills in its header and closes it.
+ * Records are written a buffer at a time, so readers
+ * must sort them by time, then by sequence.
+ */
+void flushTrace() {
+
+	if(!traceEnabled) {
+		return;
+	}
+
+	traceLock();
+
+	for(int i = 0; i < TRACE_NUM_BUFFERS; i++) {
+		int count = traceCounts[i];
+		if(count > TRACE_BUFFER_RECORDS) {
+			count = TRACE_BUFFER_RECORDS;
+		}
+		writeBuffer(i, count);
+		traceFilled[i] = 0;
+		traceCounts[i] = 0;
+	}
+
+	TraceHeader header;
+	header.magic = TRACE_MAGIC;
+	header.version = TRACE_VERSION;
+	header.numRecords = traceWritten;
+	header.dropped = traceDropped;
+
+	fseek(traceFile, 0, SEEK_SET);
+	fwrite(&header, sizeof(TraceHeader), 1, traceFile);
+	fclose(traceFile);
+	traceEnabled = 0;
+
+	traceUnlock();
+
+	aprintf("Scheduling trace: %u events written to %s, %d dropped\n",
+			header.numRecords, traceFileName, traceDropped);
+
+}
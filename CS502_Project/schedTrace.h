@@ -0,0 +1,85 @@
+/*
+ * schedTrace.h
+ *
+ *  Created on: Oct 20, 2019
+ *      Author: jean-philippe
+ */
+//intended to contain the scheduling event tracer.
+//the trace file format is also defined here, so
+//tools/traceAnalyzer.c can read what the OS writes.
+
+#ifndef SCHEDTRACE_H_
+#define SCHEDTRACE_H_
+
+#include <stdint.h>
+
+//kinds of scheduling event.
+#define TRACE_ENQUEUE 1 //made ready. arg is unused.
+#define TRACE_DISPATCH 2 //given the CPU. arg is unused.
+#define TRACE_BLOCK 3 //stopped to wait. arg is a TRACE_REASON.
+#define TRACE_WAKE 4 //done waiting. arg is a TRACE_REASON.
+#define TRACE_PREEMPT 5 //gave up the CPU while still ready. arg is the pid it gave way to.
+#define TRACE_TERMINATE 6 //terminated. arg is unused.
+
+//why a process blocked or woke.
+#define TRACE_REASON_SLEEP 1
+#define TRACE_REASON_DISK 2
+#define TRACE_REASON_MESSAGE 3
+#define TRACE_REASON_SUSPEND 4
+#define TRACE_REASON_INTERLOCK 5
+
+//events raised by the interrupt handler
+//rather than on a processor use this processor id.
+#define TRACE_INTERRUPT_PROCESSOR -1
+
+#define TRACE_MAGIC 0x53434854 //"SCHT"
+#define TRACE_VERSION 2
+#define TRACE_DEFAULT_FILE "schedTrace.bin"
+
+//the header at the start of a trace file.
+//magic: TRACE_MAGIC.
+//version: TRACE_VERSION.
+//numRecords: how many records follow the header.
+//dropped: how many events were lost because they couldn't be written.
+struct TraceHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numRecords;
+	uint32_t dropped;
+};
+
+typedef struct TraceHeader TraceHeader;
+
+//one scheduling event.
+//time: the simulated time of the event.
+//processor: the processor it happened on, or TRACE_INTERRUPT_PROCESSOR.
+//type: one of the TRACE_ event kinds.
+//pid: the process the event is about.
+//arg: extra information, depending on type.
+//seq: the order the event was recorded in, across every processor.
+//events with the same time are ordered by it.
+struct TraceRecord {
+	int32_t time;
+	int16_t processor;
+	int16_t type;
+	int32_t pid;
+	int32_t arg;
+	uint32_t seq;
+};
+
+typedef struct TraceRecord TraceRecord;
+
+#ifndef TRACE_ANALYZER
+
+#include "moreGlobals.h"
+
+int traceEnabled; //whether scheduling events are being recorded.
+
+void initTrace(char* fileName);
+void traceEvent(int type, Process* process, long arg);
+void traceInterruptEvent(int type, Process* process, long arg);
+void flushTrace();
+
+#endif
+
+#endif /* SCHEDTRACE_H_ */
@@ -93,12 +93,12 @@ void aprintf(const char *format, ...)   {
     // Note we are using an OS level lock here - the same type as a student
     // might use in an OS.  This is because the statePrinter is being executed
     // at the OS level, not within the hardware.
-    READ_MODIFY(MEMORY_INTERLOCK_BASE + SP_USER_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED,
+    Z502MemoryReadModify(MEMORY_INTERLOCK_BASE + SP_USER_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED,
 				&LockResult);
  
     vprintf(format, args);
 
-    READ_MODIFY(MEMORY_INTERLOCK_BASE + SP_USER_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
+    Z502MemoryReadModify(MEMORY_INTERLOCK_BASE + SP_USER_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED,
 			&LockResult);
     va_end(args);
 }   // End of aprint
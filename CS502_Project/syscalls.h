@@ -59,6 +59,8 @@
 #define         SYSNUM_DIR_CONTENTS                    25
 #define         SYSNUM_DELETE_DIR                      26
 #define         SYSNUM_DELETE_FILE                     27
+#define         SYSNUM_SET_DEADLINE                    28
+#define         SYSNUM_SYNC                            29
 
 // This structure defines the format used for all system calls.
 // For each call, the structure is filled in and then its address
@@ -105,8 +107,23 @@ extern int BaseThread();
 
 #define    MEM_WRITE( arg1, arg2 )   Z502MemoryWrite( arg1, (INT32 *)arg2 )
 
-#define    READ_MODIFY( arg1, arg2, arg3, arg4 )                               \
-	         Z502MemoryReadModify( arg1, arg2, arg3, arg4 )
+/*  User interlocks go through the OS.  A process that has to wait for
+    one gives up the CPU rather than blocking the hardware thread.  The
+    OS keeps its own table of these; code running in the OS itself
+    calls Z502MemoryReadModify for a hardware interlock instead.       */
+#define         READ_MODIFY( arg1, arg2, arg3, arg4 )      {                  \
+                SYSTEM_CALL_DATA *SystemCallData =                            \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof(SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 5;                        \
+                SystemCallData->SystemCallNumber = SYSNUM_READ_MODIFY;        \
+                SystemCallData->Argument[0] = (long *)arg1;                   \
+                SystemCallData->Argument[1] = (long *)arg2;                   \
+                SystemCallData->Argument[2] = (long *)arg3;                   \
+                SystemCallData->Argument[3] = (long *)arg4;                   \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );            \
+                SoftwareTrap(SystemCallData);                                 \
+                free(SystemCallData);                                         \
+                }
 
 
 
@@ -439,6 +456,53 @@ extern int BaseThread();
                 free(SystemCallData);                                         \
                 }
 
+//  Same as CREATE_PROCESS, but puts the new process in a process group.
+//  arg4 is the group id.  In M mode the members of a group are started
+//  together.  Group 0 means no group.
+#define         CREATE_PROCESS_IN_GROUP( arg1, arg2, arg3, arg4, arg5, arg6 ) { \
+                SYSTEM_CALL_DATA *SystemCallData =                            \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof(SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 7;                        \
+                SystemCallData->SystemCallNumber = SYSNUM_CREATE_PROCESS;     \
+                SystemCallData->Argument[0] = (long *)arg1;                   \
+                SystemCallData->Argument[1] = (long *)arg2;                   \
+                SystemCallData->Argument[2] = (long *)arg3;                   \
+                SystemCallData->Argument[3] = (long *)arg4;                   \
+                SystemCallData->Argument[4] = (long *)arg5;                   \
+                SystemCallData->Argument[5] = (long *)arg6;                   \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );            \
+                SoftwareTrap(SystemCallData);                                 \
+                free(SystemCallData);                                         \
+                }
+
+#define         SET_DEADLINE( arg1, arg2, arg3, arg4, arg5 )      {           \
+                SYSTEM_CALL_DATA *SystemCallData =                            \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof(SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 6;                        \
+                SystemCallData->SystemCallNumber = SYSNUM_SET_DEADLINE;       \
+                SystemCallData->Argument[0] = (long *)arg1;                   \
+                SystemCallData->Argument[1] = (long *)arg2;                   \
+                SystemCallData->Argument[2] = (long *)arg3;                   \
+                SystemCallData->Argument[3] = (long *)arg4;                   \
+                SystemCallData->Argument[4] = (long *)arg5;                   \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );            \
+                SoftwareTrap(SystemCallData);                                 \
+                free(SystemCallData);                                         \
+                }
+
+//  Writes every changed file block the OS is holding in memory
+//  out to disk.  arg1 is the error returned.
+#define         SYNC( arg1 )      {                                           \
+                SYSTEM_CALL_DATA *SystemCallData =                            \
+                     (SYSTEM_CALL_DATA *)calloc(1, sizeof(SYSTEM_CALL_DATA)); \
+                SystemCallData->NumberOfArguments = 2;                        \
+                SystemCallData->SystemCallNumber = SYSNUM_SYNC;               \
+                SystemCallData->Argument[0] = (long *)arg1;                   \
+                ChargeTimeAndCheckEvents( COST_OF_SOFTWARE_TRAP );            \
+                SoftwareTrap(SystemCallData);                                 \
+                free(SystemCallData);                                         \
+                }
+
 /*      This section includes items needed in the scheduler printer.
  It's also useful for those routines that want to communicate
  with the scheduler printer.                                       */
@@ -2794,6 +2794,1098 @@ void GetSkewedRandomNumber(long *ReturnedValue, long Pid, long range) {
 	*ReturnedValue = RandomNumber;
 } // End GetSkewedRandomNumber
 
+/**************************************************************************
+ Test50 exercises the buffer cache.
+ It writes more blocks to one file than the cache holds, so early
+ blocks are written back as they're evicted.  It then reads the
+ file back, reads the last few blocks again so they come from the
+ cache, asks for a SYNC, and reads everything once more.
+ The OS reports cache hits and misses when the simulation ends.
+ **************************************************************************/
+
+#define         TEST50_BLOCKS                  40
+#define         TEST50_HOT_BLOCKS               8
+
+int Test50_ReadBack(long Inode, int FirstBlock, int LastBlock) {
+	long ErrorReturned;
+	char ReadBuffer[PGSIZE];
+	int Index, Index2;
+	int Correct = 0;
+
+	for (Index = FirstBlock; Index < LastBlock; Index++) {
+		READ_FILE(Inode, (long )Index, &ReadBuffer, &ErrorReturned);
+		if (ErrorReturned != ERR_SUCCESS)
+			continue;
+		for (Index2 = 0; Index2 < PGSIZE ; Index2++) {
+			if (ReadBuffer[Index2] != (char) (Index + Index2))
+				break;
+		}
+		if (Index2 == PGSIZE)
+			Correct++;
+	}
+	return Correct;
+}      // End of Test50_ReadBack
+
+void test50(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long DiskID = 1;
+	long Inode;
+	char WriteBuffer[PGSIZE];
+	int Index, Index2;
+	int Correct;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 50: Pid %ld\n", TEST_VERSION, OurProcessID);
+
+	FORMAT(DiskID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "FORMAT");
+	OPEN_DIR(DiskID, "root", &ErrorReturned);
+	SuccessExpected(ErrorReturned, "OPEN_DIR of root");
+	OPEN_FILE("Cache", &Inode, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "OPEN_FILE");
+
+	for (Index = 0; Index < TEST50_BLOCKS; Index++) {
+		for (Index2 = 0; Index2 < PGSIZE ; Index2++) {
+			WriteBuffer[Index2] = (char) (Index + Index2);
+		}
+		WRITE_FILE(Inode, (long )Index, &WriteBuffer, &ErrorReturned);
+		if (ErrorReturned != ERR_SUCCESS)
+			aprintf("ERROR in Test 50 - WRITE_FILE of block %d failed\n", Index);
+	}
+
+	Correct = Test50_ReadBack(Inode, 0, TEST50_BLOCKS);
+	aprintf("Test 50: %d of %d blocks read back correctly\n", Correct,
+			TEST50_BLOCKS);
+
+	for (Index = 0; Index < 2; Index++) {
+		Correct = Test50_ReadBack(Inode, TEST50_BLOCKS - TEST50_HOT_BLOCKS,
+				TEST50_BLOCKS);
+		aprintf("Test 50: %d of %d hot blocks read back correctly\n", Correct,
+				TEST50_HOT_BLOCKS);
+	}
+
+	SYNC(&ErrorReturned);
+	SuccessExpected(ErrorReturned, "SYNC");
+
+	Correct = Test50_ReadBack(Inode, 0, TEST50_BLOCKS);
+	aprintf("Test 50: %d of %d blocks read back correctly after SYNC\n",
+			Correct, TEST50_BLOCKS);
+
+	CLOSE_FILE(Inode, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CLOSE_FILE");
+	CHECK_DISK(DiskID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CHECK_DISK");
+
+	aprintf("Test 50, PID %ld, Ends\n", OurProcessID);
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test50
+
+/**************************************************************************
+ Tests 51 and 52 look at the member disks of a volume directly.
+ Both format disk 1, write a small file and close it, then use
+ PHYSICAL_DISK_READ to see what reached each disk.
+ Test51 must be run with the "mirror" option.  Every sector on disk 1
+ must have the same contents on disk 2.
+ Test52 must be run with the "stripe=2" option.  Volume sector S is on
+ disk 1 + S % 2, at sector S / 2, so the file system's own sectors and
+ every block of the file must be found there.
+ **************************************************************************/
+
+#define         VOLUME_TEST_BLOCKS               6
+#define         VOLUME_TEST_SECTORS          0x100
+
+void VolumeTest_WriteFile(long DiskID) {
+	long ErrorReturned;
+	long Inode;
+	char WriteBuffer[PGSIZE];
+	int Index, Index2;
+
+	FORMAT(DiskID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "FORMAT");
+	OPEN_DIR(DiskID, "root", &ErrorReturned);
+	SuccessExpected(ErrorReturned, "OPEN_DIR of root");
+	OPEN_FILE("Volume", &Inode, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "OPEN_FILE");
+
+	for (Index = 0; Index < VOLUME_TEST_BLOCKS; Index++) {
+		WriteBuffer[0] = 'V';
+		for (Index2 = 1; Index2 < PGSIZE ; Index2++) {
+			WriteBuffer[Index2] = (char) (Index * 16 + Index2);
+		}
+		WRITE_FILE(Inode, (long )Index, &WriteBuffer, &ErrorReturned);
+		SuccessExpected(ErrorReturned, "WRITE_FILE");
+	}
+
+	CLOSE_FILE(Inode, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CLOSE_FILE");
+}      // End of VolumeTest_WriteFile
+
+// Returns the file block a buffer holds, or -1 if it's not one of them.
+int VolumeTest_WhichBlock(char *Buffer) {
+	int Index, Index2;
+
+	if (Buffer[0] != 'V')
+		return -1;
+	for (Index = 0; Index < VOLUME_TEST_BLOCKS; Index++) {
+		for (Index2 = 1; Index2 < PGSIZE ; Index2++) {
+			if (Buffer[Index2] != (char) (Index * 16 + Index2))
+				break;
+		}
+		if (Index2 == PGSIZE)
+			return Index;
+	}
+	return -1;
+}      // End of VolumeTest_WhichBlock
+
+void test51(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	char Buffer1[PGSIZE], Buffer2[PGSIZE];
+	long Sector;
+	int Written = 0, Differ = 0;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 51: Pid %ld\n", TEST_VERSION, OurProcessID);
+
+	VolumeTest_WriteFile(1);
+
+	for (Sector = 0; Sector < VOLUME_TEST_SECTORS; Sector++) {
+		memset(Buffer1, 0x5A, PGSIZE);
+		memset(Buffer2, 0x5A, PGSIZE);
+		PHYSICAL_DISK_READ(1, Sector, Buffer1);
+		PHYSICAL_DISK_READ(2, Sector, Buffer2);
+		if (memcmp(Buffer1, Buffer2, PGSIZE) != 0) {
+			aprintf("ERROR in Test 51 - sector %ld differs between the mirrors\n",
+					Sector);
+			Differ++;
+		}
+		memset(Buffer2, 0x5A, PGSIZE);
+		if (memcmp(Buffer1, Buffer2, PGSIZE) != 0)
+			Written++;
+	}
+
+	aprintf("Test 51: %d sectors written, %d differ between the mirrors\n",
+			Written, Differ);
+	if (Written == 0)
+		aprintf("ERROR in Test 51 - nothing reached the disks\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test51
+
+void test52(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	char Buffer[PGSIZE];
+	long Sector;
+	long Disk, MemberSector;
+	int Block;
+	int Found[VOLUME_TEST_BLOCKS];
+	int NumberFound = 0;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 52: Pid %ld\n", TEST_VERSION, OurProcessID);
+
+	VolumeTest_WriteFile(1);
+
+	for (Block = 0; Block < VOLUME_TEST_BLOCKS; Block++)
+		Found[Block] = FALSE;
+
+	for (Sector = 0; Sector < VOLUME_TEST_SECTORS; Sector++) {
+		memset(Buffer, 0, PGSIZE);
+		Disk = 1 + Sector % 2;
+		MemberSector = Sector / 2;
+		PHYSICAL_DISK_READ(Disk, MemberSector, Buffer);
+
+		if (Sector == 0 && Buffer[0] != 'Z')
+			aprintf("ERROR in Test 52 - sector 0 isn't on disk 1\n");
+		if (Sector == 0x11 && strncmp(&Buffer[1], "root", 4) != 0)
+			aprintf("ERROR in Test 52 - the root directory isn't on disk 2\n");
+
+		Block = VolumeTest_WhichBlock(Buffer);
+		if (Block != -1 && !Found[Block]) {
+			Found[Block] = TRUE;
+			NumberFound++;
+		}
+	}
+
+	aprintf("Test 52: found %d of %d file blocks on the stripes\n",
+			NumberFound, VOLUME_TEST_BLOCKS);
+	if (NumberFound != VOLUME_TEST_BLOCKS)
+		aprintf("ERROR in Test 52 - file blocks are missing\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test52
+
+/**************************************************************************
+ Test53 makes a process wait for a user interlock.
+ It locks an interlock and creates a child that tries to lock it too.
+ The child's try-lock must fail, and its suspending lock must not
+ return until test53 has unlocked it.  Test53 waits for the child to
+ terminate and checks the order things happened in.
+ **************************************************************************/
+
+#define         DO_LOCK                          1
+#define         DO_UNLOCK                        0
+#define         SUSPEND_UNTIL_LOCKED          TRUE
+#define         DO_NOT_SUSPEND               FALSE
+
+#define         TEST53_LOCK          (MEMORY_INTERLOCK_BASE + 5)
+#define         TEST53_HOLD_TIME                100
+#define         TEST53_CHECK_TIME               100
+
+// Shows how far the two processes have got.
+volatile long Test53_Progress;
+
+void Test53_Waiter(void) {
+	long ErrorReturned;
+	INT32 LockResult;
+
+	READ_MODIFY(TEST53_LOCK, DO_LOCK, DO_NOT_SUSPEND, &LockResult);
+	if (LockResult != FALSE)
+		aprintf("ERROR in Test 53 - the waiter's try-lock succeeded\n");
+	Test53_Progress = 1;
+
+	READ_MODIFY(TEST53_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	if (LockResult != TRUE)
+		aprintf("ERROR in Test 53 - the waiter didn't get the lock\n");
+	if (Test53_Progress != 2)
+		aprintf("ERROR in Test 53 - the waiter got the lock while it was held\n");
+	Test53_Progress = 3;
+
+	READ_MODIFY(TEST53_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	if (LockResult != TRUE)
+		aprintf("ERROR in Test 53 - the waiter couldn't unlock\n");
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test53_Waiter
+
+void test53(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long ProcessID;
+	INT32 LockResult;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 53: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test53_Progress = 0;
+
+	READ_MODIFY(TEST53_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	if (LockResult != TRUE)
+		aprintf("ERROR in Test 53 - couldn't lock the interlock\n");
+
+	CREATE_PROCESS("test53_waiter", Test53_Waiter, 10, &ProcessID,
+			&ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+
+	// Give the waiter time to start waiting.
+	while (Test53_Progress == 0)
+		SLEEP(TEST53_HOLD_TIME);
+	SLEEP(TEST53_HOLD_TIME);
+	if (Test53_Progress != 1)
+		aprintf("ERROR in Test 53 - the waiter went past a held lock\n");
+
+	Test53_Progress = 2;
+	READ_MODIFY(TEST53_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	if (LockResult != TRUE)
+		aprintf("ERROR in Test 53 - couldn't unlock the interlock\n");
+
+	ErrorReturned = ERR_SUCCESS;
+	while (ErrorReturned == ERR_SUCCESS) {
+		SLEEP(TEST53_CHECK_TIME);
+		GET_PROCESS_ID("test53_waiter", &ProcessID, &ErrorReturned);
+	}
+
+	aprintf("Test 53: the waiter %s the lock after it was released\n",
+			Test53_Progress == 3 ? "got" : "never got");
+	if (Test53_Progress != 3)
+		aprintf("ERROR in Test 53 - the waiter never got the lock\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test53
+
+/**************************************************************************
+ Test54 sets up a priority inversion.
+ A low priority process locks an interlock and sleeps.  A high
+ priority process then waits for that interlock, and a medium
+ priority process sleeps so it's ready when the low one wakes.
+ Test54 keeps the CPU until both have woken, then lets them run.
+ The low priority process inherits the high one's priority, so it
+ must run, and hand over the interlock, before the medium one runs.
+ Test54 must run on a single processor.
+ **************************************************************************/
+
+#define         TEST54_LOCK          (MEMORY_INTERLOCK_BASE + 6)
+#define         TEST54_HIGH_PRIORITY              5
+#define         TEST54_MEDIUM_PRIORITY           20
+#define         TEST54_LOW_PRIORITY              30
+#define         TEST54_HIGH_DELAY                50
+#define         TEST54_HOLD_TIME                300
+#define         TEST54_SPIN_TIME               1000
+
+// The order the three processes finished their work in.
+volatile char Test54_Order[4];
+volatile int Test54_Finished;
+
+void Test54_Record(char Who) {
+	Test54_Order[Test54_Finished++] = Who;
+}      // End of Test54_Record
+
+void Test54_Low(void) {
+	long ErrorReturned;
+	INT32 LockResult;
+
+	READ_MODIFY(TEST54_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	SLEEP(TEST54_HOLD_TIME);
+	Test54_Record('L');
+	READ_MODIFY(TEST54_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test54_Low
+
+void Test54_Medium(void) {
+	long ErrorReturned;
+
+	SLEEP(TEST54_HOLD_TIME);
+	Test54_Record('M');
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test54_Medium
+
+void Test54_High(void) {
+	long ErrorReturned;
+	INT32 LockResult;
+
+	// Let the low priority process get the interlock first.
+	SLEEP(TEST54_HIGH_DELAY);
+	READ_MODIFY(TEST54_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	Test54_Record('H');
+	READ_MODIFY(TEST54_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test54_High
+
+void test54(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long ProcessID;
+	long StartTime, CurrentTime;
+	long SleepTime = TEST54_HIGH_DELAY * 2;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 54: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test54_Finished = 0;
+
+	CREATE_PROCESS("test54_high", Test54_High, TEST54_HIGH_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test54_medium", Test54_Medium, TEST54_MEDIUM_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test54_low", Test54_Low, TEST54_LOW_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+
+	// Let them all start, and the high one start waiting.
+	SLEEP(SleepTime);
+
+	// Hold the CPU until the low and medium ones are both ready.
+	GET_TIME_OF_DAY(&StartTime);
+	do {
+		GET_TIME_OF_DAY(&CurrentTime);
+	} while (CurrentTime < StartTime + TEST54_SPIN_TIME);
+
+	while (Test54_Finished < 3)
+		SLEEP(TEST54_HOLD_TIME);
+
+	aprintf("Test 54: the processes finished in the order %c %c %c\n",
+			Test54_Order[0], Test54_Order[1], Test54_Order[2]);
+	if (Test54_Order[0] != 'L' || Test54_Order[1] != 'H')
+		aprintf("ERROR in Test 54 - the medium priority process ran first\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test54
+
+/**************************************************************************
+ Test55 exercises SET_DEADLINE.
+ It first checks that bad parameters are refused.  It then makes two
+ new processes real-time.  Test55_Hog gets the earlier deadline but a
+ small budget, and runs far past that budget without sleeping.
+ Test55_Job has a later deadline and a short piece of work.
+ Once the hog uses up its budget, the OS must postpone its deadline
+ and give the CPU to the job process, so the job finishes first.
+ Test55 must run on a single processor.
+ **************************************************************************/
+
+#define         TEST55_HOG_PERIOD              2000
+#define         TEST55_HOG_DEADLINE            1000
+#define         TEST55_HOG_BUDGET               100
+#define         TEST55_HOG_WORK                1000
+#define         TEST55_JOB_PERIOD              4000
+#define         TEST55_JOB_DEADLINE            1500
+#define         TEST55_JOB_BUDGET               100
+#define         TEST55_JOB_WORK                  50
+#define         TEST55_WAIT_TIME                500
+
+// The order the two processes finished their work in.
+volatile char Test55_Order[3];
+volatile int Test55_Finished;
+
+// Uses the CPU for about the given time without giving it up.
+void Test55_Work(long Duration) {
+	long StartTime, CurrentTime;
+
+	GET_TIME_OF_DAY(&StartTime);
+	do {
+		GET_TIME_OF_DAY(&CurrentTime);
+	} while (CurrentTime < StartTime + Duration);
+}      // End of Test55_Work
+
+void Test55_Job(void) {
+	long ErrorReturned;
+
+	Test55_Work(TEST55_JOB_WORK);
+	Test55_Order[Test55_Finished++] = 'J';
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test55_Job
+
+void Test55_Hog(void) {
+	long ErrorReturned;
+
+	Test55_Work(TEST55_HOG_WORK);
+	Test55_Order[Test55_Finished++] = 'H';
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test55_Hog
+
+void test55(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long HogID, JobID;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 55: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test55_Finished = 0;
+
+	// A deadline longer than the period, a budget longer than the
+	// deadline, and a process that doesn't exist.
+	SET_DEADLINE(-1, 100, 200, 50, &ErrorReturned);
+	ErrorExpected(ErrorReturned, "SET_DEADLINE");
+	SET_DEADLINE(-1, 100, 100, 150, &ErrorReturned);
+	ErrorExpected(ErrorReturned, "SET_DEADLINE");
+	SET_DEADLINE(-99, 100, 100, 50, &ErrorReturned);
+	ErrorExpected(ErrorReturned, "SET_DEADLINE");
+
+	CREATE_PROCESS("test55_hog", Test55_Hog, 10, &HogID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test55_job", Test55_Job, 20, &JobID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+
+	// Neither has run yet, so the hog will be dispatched first.
+	SET_DEADLINE(HogID, TEST55_HOG_PERIOD, TEST55_HOG_DEADLINE,
+			TEST55_HOG_BUDGET, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "SET_DEADLINE");
+	SET_DEADLINE(JobID, TEST55_JOB_PERIOD, TEST55_JOB_DEADLINE,
+			TEST55_JOB_BUDGET, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "SET_DEADLINE");
+
+	while (Test55_Finished < 2)
+		SLEEP(TEST55_WAIT_TIME);
+
+	aprintf("Test 55: the processes finished in the order %c %c\n",
+			Test55_Order[0], Test55_Order[1]);
+	if (Test55_Order[0] != 'J')
+		aprintf("ERROR in Test 55 - the hog ran past its budget\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test55
+
+/**************************************************************************
+ Test56 creates and ends far more processes, one after another, than
+ the hardware has threads.  Half of them terminate themselves.  The
+ other half go to sleep for far longer than the test runs, and are
+ terminated by test56 while they sleep.  The OS must give each
+ terminated process's context back to the hardware, so every
+ CREATE_PROCESS succeeds.
+ **************************************************************************/
+
+#define         TEST56_ROUNDS     (2 * MAX_NUMBER_OF_USER_THREADS)
+#define         TEST56_WAIT_TIME                 20
+#define         TEST56_SLEEP_TIME           1000000
+
+volatile int Test56_Started;
+
+void Test56_Quitter(void) {
+	long ErrorReturned;
+
+	Test56_Started++;
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test56_Quitter
+
+void Test56_Sleeper(void) {
+	long ErrorReturned;
+
+	Test56_Started++;
+	SLEEP(TEST56_SLEEP_TIME);
+	aprintf("ERROR in Test 56 - a terminated process woke up\n");
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test56_Sleeper
+
+void test56(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long ProcessID;
+	char ProcessName[16];
+	int Round;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 56: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test56_Started = 0;
+
+	for (Round = 0; Round < TEST56_ROUNDS; Round++) {
+		sprintf(ProcessName, "Test56_%d", Round);
+		if (Round % 2 == 0) {
+			CREATE_PROCESS(ProcessName, Test56_Quitter, 5, &ProcessID,
+					&ErrorReturned);
+		} else {
+			CREATE_PROCESS(ProcessName, Test56_Sleeper, 5, &ProcessID,
+					&ErrorReturned);
+		}
+		if (ErrorReturned != ERR_SUCCESS) {
+			aprintf("ERROR in Test 56 - couldn't create process %d\n", Round);
+			break;
+		}
+
+		// Wait for it to start, and for a quitter to be gone.
+		ErrorReturned = ERR_SUCCESS;
+		while (Test56_Started <= Round || ErrorReturned == ERR_SUCCESS) {
+			SLEEP(TEST56_WAIT_TIME);
+			GET_PROCESS_ID(ProcessName, &ProcessID, &ErrorReturned);
+			if (Round % 2 == 1 && Test56_Started > Round)
+				break;
+		}
+
+		if (Round % 2 == 1) {
+			TERMINATE_PROCESS(ProcessID, &ErrorReturned);
+			SuccessExpected(ErrorReturned, "TERMINATE_PROCESS");
+		}
+	}
+
+	aprintf("Test 56: %d processes created and ended\n", Test56_Started);
+	if (Test56_Started != TEST56_ROUNDS)
+		aprintf("ERROR in Test 56 - not every process ran\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test56
+
+/**************************************************************************
+ Test57 checks that the members of a process group start together.
+ Two hogs take two of the three processors.  Then three members of
+ group TEST57_GROUP and one process outside any group are created, and
+ test57 goes to sleep, which frees the third processor.  The group
+ doesn't fit on one processor, so none of its members may start there.
+ After a short hold, the process outside the group gets the free
+ processor instead.  When it finishes, it tells the hogs to stop, and
+ only then may the whole group start, all at once.
+ Test57 must run as a multiprocessor with three processors:
+     test57 M cpus=3
+ **************************************************************************/
+
+#define         TEST57_GROUP                      7
+#define         TEST57_MEMBERS                    3
+#define         TEST57_HOG_PRIORITY              10
+#define         TEST57_MEMBER_PRIORITY           10
+#define         TEST57_OTHER_PRIORITY            20
+#define         TEST57_WAIT_TIME                 50
+#define         TEST57_LOCK          (MEMORY_INTERLOCK_BASE + 7)
+
+volatile int Test57_OtherDone;
+volatile int Test57_HogsDone;
+volatile int Test57_Started;
+volatile int Test57_StartedEarly;
+volatile long Test57_OtherEnd;
+volatile long Test57_HogEnd[2];
+volatile long Test57_MemberStart[TEST57_MEMBERS];
+
+void Test57_Hog(void) {
+	long ErrorReturned;
+	long CurrentTime;
+	INT32 LockResult;
+
+	// Hold a processor until the process outside the group is done.
+	do {
+		GET_TIME_OF_DAY(&CurrentTime);
+	} while (!Test57_OtherDone);
+	GET_TIME_OF_DAY(&CurrentTime);
+	READ_MODIFY(TEST57_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	Test57_HogEnd[Test57_HogsDone++] = CurrentTime;
+	READ_MODIFY(TEST57_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test57_Hog
+
+void Test57_Other(void) {
+	long ErrorReturned;
+	long CurrentTime;
+
+	GET_TIME_OF_DAY(&CurrentTime);
+	Test57_OtherEnd = CurrentTime;
+	Test57_OtherDone = 1;
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test57_Other
+
+void Test57_Member(void) {
+	long ErrorReturned;
+	long CurrentTime;
+	INT32 LockResult;
+
+	GET_TIME_OF_DAY(&CurrentTime);
+	// The members run side by side, so they take turns recording.
+	READ_MODIFY(TEST57_LOCK, DO_LOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	Test57_MemberStart[Test57_Started++] = CurrentTime;
+	if (Test57_HogsDone < 2)
+		Test57_StartedEarly = 1;
+	READ_MODIFY(TEST57_LOCK, DO_UNLOCK, SUSPEND_UNTIL_LOCKED, &LockResult);
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test57_Member
+
+void test57(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long ProcessID;
+	char ProcessName[16];
+	int Member;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 57: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test57_OtherDone = 0;
+	Test57_HogsDone = 0;
+	Test57_Started = 0;
+	Test57_StartedEarly = 0;
+
+	CREATE_PROCESS("test57_hog0", Test57_Hog, TEST57_HOG_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test57_hog1", Test57_Hog, TEST57_HOG_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+
+	for (Member = 0; Member < TEST57_MEMBERS; Member++) {
+		sprintf(ProcessName, "test57_member%d", Member);
+		CREATE_PROCESS_IN_GROUP(ProcessName, Test57_Member,
+				TEST57_MEMBER_PRIORITY, TEST57_GROUP, &ProcessID,
+				&ErrorReturned);
+		SuccessExpected(ErrorReturned, "CREATE_PROCESS_IN_GROUP");
+	}
+	CREATE_PROCESS("test57_other", Test57_Other, TEST57_OTHER_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+
+	while (Test57_Started < TEST57_MEMBERS)
+		SLEEP(TEST57_WAIT_TIME);
+
+	aprintf("Test 57: other ended at %ld, hogs ended at %ld and %ld\n",
+			Test57_OtherEnd, Test57_HogEnd[0], Test57_HogEnd[1]);
+	for (Member = 0; Member < TEST57_MEMBERS; Member++) {
+		aprintf("Test 57: a group member started at %ld\n",
+				Test57_MemberStart[Member]);
+		if (Test57_OtherDone && Test57_MemberStart[Member] < Test57_OtherEnd)
+			aprintf("ERROR in Test 57 - the group held the processor for too long\n");
+	}
+	if (Test57_StartedEarly)
+		aprintf("ERROR in Test 57 - a group member started before the group fit\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test57
+
+/**************************************************************************
+ Test58 terminates other processes while they're busy.
+ Test58_Spinner never gives up its processor, so it's terminated while
+ it runs on another processor.  Test58_DiskUser keeps writing to disk,
+ so it's almost always terminated while it waits for the disk.
+ Neither may run again once it's terminated: the spinner must end the
+ next time it calls the OS, and the disk user must not be woken when
+ its write finishes.  A new process must still be able to run after.
+ Test58 must run as a multiprocessor.
+ **************************************************************************/
+
+#define         TEST58_PRIORITY                  10
+#define         TEST58_DISK                       1
+#define         TEST58_SECTOR                   100
+#define         TEST58_WAIT_TIME                100
+#define         TEST58_SETTLE_TIME             2000
+
+volatile long Test58_Spins;
+volatile long Test58_DiskWrites;
+volatile int Test58_Ran;
+
+// Kept out of the disk user's stack, since the disk may
+// still write from it after the disk user is gone.
+DISK_DATA Test58_Data;
+
+void Test58_Spinner(void) {
+	long CurrentTime;
+
+	while (1) {
+		GET_TIME_OF_DAY(&CurrentTime);
+		Test58_Spins++;
+	}
+}      // End of Test58_Spinner
+
+void Test58_DiskUser(void) {
+
+	while (1) {
+		Test58_Data.int_data[0] = Test58_DiskWrites;
+		PHYSICAL_DISK_WRITE(TEST58_DISK, TEST58_SECTOR,
+				(char* )(Test58_Data.char_data));
+		Test58_DiskWrites++;
+	}
+}      // End of Test58_DiskUser
+
+void Test58_Later(void) {
+	long ErrorReturned;
+
+	Test58_Ran = 1;
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test58_Later
+
+void test58(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long SpinnerID, DiskUserID, ProcessID;
+	long Spins, DiskWrites;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 58: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test58_Spins = 0;
+	Test58_DiskWrites = 0;
+	Test58_Ran = 0;
+
+	CREATE_PROCESS("test58_spinner", Test58_Spinner, TEST58_PRIORITY,
+			&SpinnerID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test58_disk", Test58_DiskUser, TEST58_PRIORITY,
+			&DiskUserID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+
+	while (Test58_Spins == 0 || Test58_DiskWrites == 0)
+		SLEEP(TEST58_WAIT_TIME);
+
+	TERMINATE_PROCESS(SpinnerID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "TERMINATE_PROCESS");
+	TERMINATE_PROCESS(DiskUserID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "TERMINATE_PROCESS");
+
+	// The spinner may get one more turn round its loop before it
+	// next calls the OS and is gone.  After that, nothing may change.
+	do {
+		SLEEP(TEST58_WAIT_TIME);
+		GET_PROCESS_ID("test58_spinner", &ProcessID, &ErrorReturned);
+	} while (ErrorReturned == ERR_SUCCESS);
+	Spins = Test58_Spins;
+	DiskWrites = Test58_DiskWrites;
+	SLEEP(TEST58_SETTLE_TIME);
+
+	aprintf("Test 58: %ld spins and %ld disk writes before they were terminated\n",
+			Spins, DiskWrites);
+	if (Test58_Spins != Spins)
+		aprintf("ERROR in Test 58 - the spinner kept running\n");
+	if (Test58_DiskWrites != DiskWrites)
+		aprintf("ERROR in Test 58 - the disk user was woken after it was terminated\n");
+
+	GET_PROCESS_ID("test58_disk", &ProcessID, &ErrorReturned);
+	ErrorExpected(ErrorReturned, "GET_PROCESS_ID");
+
+	CREATE_PROCESS("test58_later", Test58_Later, TEST58_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	while (!Test58_Ran)
+		SLEEP(TEST58_WAIT_TIME);
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test58
+
+/**************************************************************************
+ Test59 checks that reads of a mirrored volume are spread over both
+ members.  It writes the usual six block file to disk 1, then writes
+ enough other blocks to push those six out of the buffer cache, so
+ reading them has to go to the disk.  It then marks each of the six on
+ disk 2 only, so a read shows which member served it.  Two readers read
+ the blocks at the same time.  While one waits for a member, the other
+ should be sent to the idle one, so both members must serve some reads.
+ Test59 must be run with the "mirror" option.
+ **************************************************************************/
+
+#define         TEST59_FILLER_BLOCKS             48
+#define         TEST59_READERS                    2
+#define         TEST59_ROUNDS                     4
+#define         TEST59_WAIT_TIME                100
+
+volatile long Test59_Inode;
+volatile int Test59_FromDisk1;
+volatile int Test59_FromDisk2;
+volatile int Test59_Finished;
+
+void Test59_Reader(void) {
+	long ErrorReturned;
+	char ReadBuffer[PGSIZE];
+	int Round, Block;
+
+	OPEN_DIR(1, "root", &ErrorReturned);
+	SuccessExpected(ErrorReturned, "OPEN_DIR of root");
+
+	for (Round = 0; Round < TEST59_ROUNDS; Round++) {
+		for (Block = 0; Block < VOLUME_TEST_BLOCKS; Block++) {
+			READ_FILE(Test59_Inode, (long )Block, &ReadBuffer, &ErrorReturned);
+			SuccessExpected(ErrorReturned, "READ_FILE");
+			if (VolumeTest_WhichBlock(ReadBuffer) == Block)
+				Test59_FromDisk1++;
+			else if (ReadBuffer[0] == 'M' && ReadBuffer[1] == Block)
+				Test59_FromDisk2++;
+			else
+				aprintf("ERROR in Test 59 - block %d read back wrong\n", Block);
+		}
+	}
+
+	Test59_Finished++;
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test59_Reader
+
+void test59(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long Inode, ProcessID;
+	char Buffer[PGSIZE];
+	char ProcessName[16];
+	long Sector;
+	int Block, Reader;
+	int Marked = 0;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 59: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test59_FromDisk1 = 0;
+	Test59_FromDisk2 = 0;
+	Test59_Finished = 0;
+
+	VolumeTest_WriteFile(1);
+
+	// Push the file's blocks out of the cache.
+	OPEN_FILE("Filler", &Inode, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "OPEN_FILE");
+	memset(Buffer, 'F', PGSIZE);
+	for (Block = 0; Block < TEST59_FILLER_BLOCKS; Block++) {
+		WRITE_FILE(Inode, (long )Block, &Buffer, &ErrorReturned);
+		SuccessExpected(ErrorReturned, "WRITE_FILE");
+	}
+	CLOSE_FILE(Inode, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CLOSE_FILE");
+
+	// Mark the file's blocks on the second mirror only.
+	for (Sector = 0; Sector < VOLUME_TEST_SECTORS; Sector++) {
+		PHYSICAL_DISK_READ(2, Sector, Buffer);
+		Block = VolumeTest_WhichBlock(Buffer);
+		if (Block != -1) {
+			memset(Buffer, 0, PGSIZE);
+			Buffer[0] = 'M';
+			Buffer[1] = (char) Block;
+			PHYSICAL_DISK_WRITE(2, Sector, Buffer);
+			Marked++;
+		}
+	}
+	if (Marked != VOLUME_TEST_BLOCKS)
+		aprintf("ERROR in Test 59 - found %d file blocks on disk 2\n", Marked);
+
+	OPEN_FILE("Volume", &Inode, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "OPEN_FILE");
+	Test59_Inode = Inode;
+
+	for (Reader = 0; Reader < TEST59_READERS; Reader++) {
+		sprintf(ProcessName, "test59_%d", Reader);
+		CREATE_PROCESS(ProcessName, Test59_Reader, 10, &ProcessID,
+				&ErrorReturned);
+		SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	}
+
+	while (Test59_Finished < TEST59_READERS)
+		SLEEP(TEST59_WAIT_TIME);
+
+	aprintf("Test 59: %d reads from disk 1, %d reads from disk 2\n",
+			Test59_FromDisk1, Test59_FromDisk2);
+	if (Test59_FromDisk1 == 0 || Test59_FromDisk2 == 0)
+		aprintf("ERROR in Test 59 - every read went to the same mirror\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test59
+
+/**************************************************************************
+ Test60 checks that the fair policy shares the CPU by priority.
+ Two processes that never wait, one at priority 10 and one at
+ priority 20, count how many times round a loop they get until a
+ shared end time.  A priority 10 process accrues virtual runtime at
+ the base rate, and a priority 20 one at 21 / 11 of it, so the first
+ should get about 1.9 times the CPU the second does.
+ Test60 must be run on a single processor with the "sched=fair" option.
+ **************************************************************************/
+
+#define         TEST60_HIGH_PRIORITY             10
+#define         TEST60_LOW_PRIORITY              20
+#define         TEST60_RUN_TIME               20000
+#define         TEST60_WAIT_TIME                500
+
+volatile long Test60_EndTime;
+volatile long Test60_Loops[2];
+volatile int Test60_Finished;
+
+void Test60_Worker(int Which) {
+	long ErrorReturned;
+	long CurrentTime;
+
+	do {
+		GET_TIME_OF_DAY(&CurrentTime);
+		Test60_Loops[Which]++;
+	} while (CurrentTime < Test60_EndTime);
+
+	Test60_Finished++;
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test60_Worker
+
+void Test60_High(void) {
+	Test60_Worker(0);
+}      // End of Test60_High
+
+void Test60_Low(void) {
+	Test60_Worker(1);
+}      // End of Test60_Low
+
+void test60(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long ProcessID;
+	long CurrentTime;
+	double Ratio;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 60: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test60_Loops[0] = 0;
+	Test60_Loops[1] = 0;
+	Test60_Finished = 0;
+
+	GET_TIME_OF_DAY(&CurrentTime);
+	Test60_EndTime = CurrentTime + TEST60_RUN_TIME;
+
+	CREATE_PROCESS("test60_high", Test60_High, TEST60_HIGH_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test60_low", Test60_Low, TEST60_LOW_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+
+	while (Test60_Finished < 2)
+		SLEEP(TEST60_WAIT_TIME);
+
+	Ratio = (double) Test60_Loops[0] / (Test60_Loops[1] > 0 ? Test60_Loops[1] : 1);
+	aprintf("Test 60: priority %d looped %ld times, priority %d looped %ld times, ratio %4.2f\n",
+			TEST60_HIGH_PRIORITY, Test60_Loops[0], TEST60_LOW_PRIORITY,
+			Test60_Loops[1], Ratio);
+	if (Ratio < 1.5 || Ratio > 2.4)
+		aprintf("ERROR in Test 60 - the CPU wasn't shared by priority\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test60
+
+/**************************************************************************
+ Test61 checks that writes to the same sector are merged while they
+ wait, and that a read is served from a write that hasn't reached the
+ disk yet.  Three writers write the same sector one after another.
+ The first write goes to the disk.  The second has to wait for it.
+ The third replaces the second, which is then finished without going
+ to the disk, so the second writer must be done before the first.
+ A reader then reads the sector, and must get the third writer's data
+ even though it isn't on the disk yet.  The third write is what ends
+ up on the disk.
+ Test61 must run on a single processor.
+ **************************************************************************/
+
+#define         TEST61_DISK                       1
+#define         TEST61_SECTOR                   200
+#define         TEST61_WRITERS                    3
+#define         TEST61_READER_PRIORITY           40
+#define         TEST61_WAIT_TIME                100
+
+volatile int Test61_Order[TEST61_WRITERS];
+volatile int Test61_Finished;
+volatile int Test61_ReadFrom;
+DISK_DATA Test61_Data[TEST61_WRITERS];
+
+void Test61_Writer(int Which) {
+	long ErrorReturned;
+
+	memset(Test61_Data[Which].char_data, 'A' + Which, PGSIZE);
+	PHYSICAL_DISK_WRITE(TEST61_DISK, TEST61_SECTOR,
+			(char* )(Test61_Data[Which].char_data));
+	Test61_Order[Test61_Finished++] = Which;
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test61_Writer
+
+void Test61_Writer0(void) {
+	Test61_Writer(0);
+}      // End of Test61_Writer0
+
+void Test61_Writer1(void) {
+	Test61_Writer(1);
+}      // End of Test61_Writer1
+
+void Test61_Writer2(void) {
+	Test61_Writer(2);
+}      // End of Test61_Writer2
+
+void Test61_Reader(void) {
+	long ErrorReturned;
+	DISK_DATA ReadBuffer;
+
+	PHYSICAL_DISK_READ(TEST61_DISK, TEST61_SECTOR,
+			(char* )(ReadBuffer.char_data));
+	Test61_ReadFrom = ReadBuffer.char_data[0] - 'A';
+	TERMINATE_PROCESS(-1, &ErrorReturned);
+}      // End of Test61_Reader
+
+void test61(void) {
+	long OurProcessID;
+	long ErrorReturned;
+	long ProcessID;
+	DISK_DATA ReadBuffer;
+
+	GET_PROCESS_ID("", &OurProcessID, &ErrorReturned);
+	aprintf("Release %s: Test 61: Pid %ld\n", TEST_VERSION, OurProcessID);
+	Test61_Finished = 0;
+	Test61_ReadFrom = -1;
+
+	// Each waits for the disk in turn, so they run in priority order.
+	CREATE_PROCESS("test61_w0", Test61_Writer0, 10, &ProcessID,
+			&ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test61_w1", Test61_Writer1, 20, &ProcessID,
+			&ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test61_w2", Test61_Writer2, 30, &ProcessID,
+			&ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+	CREATE_PROCESS("test61_reader", Test61_Reader, TEST61_READER_PRIORITY,
+			&ProcessID, &ErrorReturned);
+	SuccessExpected(ErrorReturned, "CREATE_PROCESS");
+
+	while (Test61_Finished < TEST61_WRITERS || Test61_ReadFrom == -1)
+		SLEEP(TEST61_WAIT_TIME);
+
+	aprintf("Test 61: the writers finished in the order %d %d %d, the reader got write %d\n",
+			Test61_Order[0], Test61_Order[1], Test61_Order[2], Test61_ReadFrom);
+	if (Test61_Order[0] != 1)
+		aprintf("ERROR in Test 61 - the second write wasn't merged into the third\n");
+	if (Test61_ReadFrom != 2)
+		aprintf("ERROR in Test 61 - the read didn't get the latest write\n");
+
+	PHYSICAL_DISK_READ(TEST61_DISK, TEST61_SECTOR,
+			(char* )(ReadBuffer.char_data));
+	if (memcmp(ReadBuffer.char_data, Test61_Data[2].char_data, PGSIZE) != 0)
+		aprintf("ERROR in Test 61 - the last write isn't on the disk\n");
+
+	TERMINATE_PROCESS(-2, &ErrorReturned);
+}      // End of test61
+
 /*****************************************************************
  testStartCode()
  A new thread (other than the initial thread) comes here the
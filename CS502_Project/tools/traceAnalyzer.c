@@ -0,0 +1,257 @@
+/*
+ * traceAnalyzer.c
+ *
+ *  Created on: Oct 20, 2019
+ *      Author: jean-philippe
+ */
+//reads a trace written by the OS's scheduling tracer
+//and reports, for each process, percentiles of:
+//wait time: from being made ready to being dispatched.
+//response time: from waking up to being dispatched.
+//and the share of CPU time the process received.
+//usage: traceAnalyzer [traceFile]
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_ANALYZER
+#include "../schedTrace.h"
+
+//the largest pid the analyzer keeps statistics for.
+#define MAX_TRACED_PIDS 256
+
+//a growable list of samples for one metric.
+struct SampleList {
+	long* samples;
+	int count;
+	int capacity;
+};
+
+typedef struct SampleList SampleList;
+
+//everything the analyzer knows about one process.
+//readySince: when it was last made ready. -1 if not ready.
+//wokeAt: when it last woke. -1 if it hasn't woken since its last dispatch.
+//runningSince: when it was last dispatched. -1 if not running.
+//cpuTime: the total time it spent dispatched.
+struct ProcessStats {
+	int seen;
+	long readySince;
+	long wokeAt;
+	long runningSince;
+	long cpuTime;
+	SampleList waits;
+	SampleList responses;
+};
+
+typedef struct ProcessStats ProcessStats;
+
+ProcessStats stats[MAX_TRACED_PIDS];
+
+/**
+ * Adds a sample to a list, growing it as needed.
+ */
+void addSample(SampleList* list, long sample) {
+
+	if(list->count == list->capacity) {
+		list->capacity = list->capacity == 0 ? 64 : list->capacity * 2;
+		list->samples = (long*)realloc(list->samples, list->capacity * sizeof(long));
+	}
+
+	list->samples[list->count++] = sample;
+
+}
+
+/**
+ * Orders records by time. Records with the same time
+ * are ordered by when they were recorded.
+ */
+int compareRecords(const void* a, const void* b) {
+
+	const TraceRecord* first = (const TraceRecord*)a;
+	const TraceRecord* second = (const TraceRecord*)b;
+
+	if(first->time != second->time) {
+		return first->time < second->time ? -1 : 1;
+	}
+
+	return first->seq < second->seq ? -1 : (first->seq > second->seq);
+
+}
+
+int compareLongs(const void* a, const void* b) {
+	long first = *(const long*)a;
+	long second = *(const long*)b;
+	return first < second ? -1 : (first > second);
+}
+
+/**
+ * Returns the given percentile of a sorted list of samples.
+ * Parameters:
+ * list: the samples, sorted in ascending order.
+ * percent: the percentile, from 0 to 100.
+ */
+long percentile(SampleList* list, int percent) {
+
+	int index = (list->count * percent + 99) / 100 - 1;
+
+	if(index < 0) {
+		index = 0;
+	}
+
+	return list->samples[index];
+
+}
+
+/**
+ * Prints one row of percentiles for a metric,
+ * or dashes if there were no samples.
+ */
+void printPercentiles(SampleList* list) {
+
+	if(list->count == 0) {
+		printf(" %6s %6s %6s %6s", "-", "-", "-", "-");
+		return;
+	}
+
+	qsort(list->samples, list->count, sizeof(long), compareLongs);
+	printf(" %6ld %6ld %6ld %6ld", percentile(list, 50), percentile(list, 90),
+			percentile(list, 99), list->samples[list->count - 1]);
+
+}
+
+/**
+ * Ends a process's current run, if it is running.
+ */
+void stopRunning(ProcessStats* process, long time) {
+
+	if(process->runningSince != -1) {
+		process->cpuTime += time - process->runningSince;
+		process->runningSince = -1;
+	}
+
+}
+
+int main(int argc, char* argv[]) {
+
+	char* fileName = argc > 1 ? argv[1] : TRACE_DEFAULT_FILE;
+	FILE* file = fopen(fileName, "rb");
+
+	if(file == NULL) {
+		fprintf(stderr, "Could not open %s\n", fileName);
+		return 1;
+	}
+
+	TraceHeader header;
+
+	if(fread(&header, sizeof(TraceHeader), 1, file) != 1
+			|| header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) {
+		fprintf(stderr, "%s is not a scheduling trace\n", fileName);
+		fclose(file);
+		return 1;
+	}
+
+	TraceRecord* records = (TraceRecord*)calloc(header.numRecords + 1, sizeof(TraceRecord));
+	int numRecords = fread(records, sizeof(TraceRecord), header.numRecords, file);
+	fclose(file);
+
+	qsort(records, numRecords, sizeof(TraceRecord), compareRecords);
+
+	for(int i = 0; i < MAX_TRACED_PIDS; i++) {
+		stats[i].readySince = -1;
+		stats[i].wokeAt = -1;
+		stats[i].runningSince = -1;
+	}
+
+	long startTime = numRecords > 0 ? records[0].time : 0;
+	long endTime = numRecords > 0 ? records[numRecords - 1].time : 0;
+
+	for(int i = 0; i < numRecords; i++) {
+
+		TraceRecord* record = &records[i];
+
+		if(record->pid < 0 || record->pid >= MAX_TRACED_PIDS) {
+			continue;
+		}
+
+		ProcessStats* process = &stats[record->pid];
+		process->seen = 1;
+
+		switch(record->type) {
+
+		case TRACE_ENQUEUE:
+			//being made ready while running means it yielded.
+			stopRunning(process, record->time);
+			if(process->readySince == -1) {
+				process->readySince = record->time;
+			}
+			break;
+
+		case TRACE_DISPATCH:
+			if(process->readySince != -1) {
+				addSample(&process->waits, record->time - process->readySince);
+				process->readySince = -1;
+			}
+			if(process->wokeAt != -1) {
+				addSample(&process->responses, record->time - process->wokeAt);
+				process->wokeAt = -1;
+			}
+			process->runningSince = record->time;
+			break;
+
+		case TRACE_WAKE:
+			process->wokeAt = record->time;
+			break;
+
+		case TRACE_BLOCK:
+		case TRACE_PREEMPT:
+			stopRunning(process, record->time);
+			break;
+
+		case TRACE_TERMINATE:
+			stopRunning(process, record->time);
+			process->readySince = -1;
+			process->wokeAt = -1;
+			break;
+
+		}
+
+	}
+
+	//anything still running was running until the end of the trace.
+	for(int i = 0; i < MAX_TRACED_PIDS; i++) {
+		stopRunning(&stats[i], endTime);
+	}
+
+	long totalTime = endTime - startTime;
+
+	printf("Trace %s: %d events over %ld time units, %u dropped\n",
+			fileName, numRecords, totalTime, header.dropped);
+	printf("%4s | %-27s | %-27s | %6s\n", "", "wait time", "response time", "CPU");
+	printf("%4s | %6s %6s %6s %6s | %6s %6s %6s %6s | %6s\n", "pid",
+			"p50", "p90", "p99", "max", "p50", "p90", "p99", "max", "share");
+
+	for(int i = 0; i < MAX_TRACED_PIDS; i++) {
+
+		if(!stats[i].seen) {
+			continue;
+		}
+
+		printf("%4d |", i);
+		printPercentiles(&stats[i].waits);
+		printf(" |");
+		printPercentiles(&stats[i].responses);
+
+		if(totalTime > 0) {
+			printf(" | %5.1f%%\n", 100.0 * stats[i].cpuTime / totalTime);
+		} else {
+			printf(" | %6s\n", "-");
+		}
+
+	}
+
+	free(records);
+	return 0;
+
+}
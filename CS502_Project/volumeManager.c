@@ -0,0 +1,214 @@
+/*
+ * volumeManager.c
+ *
+ *  Created on: Oct 24, 2019
+ *      Author: jean-philippe
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "global.h"
+#include "syscalls.h"
+#include "protos.h"
+#include "moreGlobals.h"
+#include "diskManager.h"
+#include "volumeManager.h"
+
+/**
+ * Makes every disk a volume of its own.
+ */
+void initVolumes() {
+
+	for(int i = 0; i < MAX_NUMBER_OF_DISKS; i++) {
+		volumes[i].type = VOLUME_SINGLE;
+		volumes[i].numMembers = 1;
+		volumes[i].members[0] = i;
+	}
+
+}
+
+/**
+ * Sets up the volume for a disk being formatted. If mirroring is on,
+ * the next disk becomes a copy of it. Otherwise, if striping is on,
+ * the volume takes in the next stripeWidth - 1 disks as well.
+ * Either way, member disks wrap around past the last disk.
+ * Parameters:
+ * diskID: the disk being formatted.
+ */
+void createVolume(long diskID) {
+
+	Volume* volume = &volumes[diskID];
+	int width = stripeWidth;
+
+	if(mirrorVolumes) {
+
+		volume->type = VOLUME_MIRRORED;
+		volume->numMembers = 2;
+		volume->members[0] = diskID;
+		volume->members[1] = (diskID + 1) % MAX_NUMBER_OF_DISKS;
+
+		aprintf("Disk %ld is mirrored on disk %ld\n", diskID, volume->members[1]);
+
+		if(volume->members[1] < diskID) {
+			aprintf("Warning: the mirror wraps around to disk %ld, which wasn't formatted\n",
+					volume->members[1]);
+		}
+
+		return;
+
+	}
+
+	if(width <= 1) {
+		volume->type = VOLUME_SINGLE;
+		volume->numMembers = 1;
+		volume->members[0] = diskID;
+		return;
+	}
+
+	volume->type = VOLUME_STRIPED;
+	volume->numMembers = width;
+
+	for(int i = 0; i < width; i++) {
+		volume->members[i] = (diskID + i) % MAX_NUMBER_OF_DISKS;
+	}
+
+	aprintf("Disk %ld is striped over %d disks\n", diskID, width);
+
+	if(diskID + width > MAX_NUMBER_OF_DISKS) {
+		aprintf("Warning: the stripe wraps around past disk %d onto disks that weren't formatted\n",
+				MAX_NUMBER_OF_DISKS - 1);
+	}
+
+}
+
+/**
+ * Picks which member of a mirrored volume should serve a read.
+ * An idle member is preferred, then whichever head is nearest
+ * the sector. Other requests can change the disks at any time,
+ * so this is only a good guess.
+ * Parameters:
+ * volume: the mirrored volume.
+ * sector: the sector to read.
+ * Returns the member disk to read from.
+ */
+long chooseMirror(Volume* volume, long sector) {
+
+	long best = volume->members[0];
+	int bestIdle = 0;
+	long bestDistance = -1;
+
+	for(int i = 0; i < volume->numMembers; i++) {
+
+		long diskID = volume->members[i];
+		int idle = isDiskIdle(diskID);
+		long distance = labs(getDiskHead(diskID) - sector);
+
+		if(bestDistance == -1 || idle > bestIdle
+				|| (idle == bestIdle && distance < bestDistance)) {
+			best = diskID;
+			bestIdle = idle;
+			bestDistance = distance;
+		}
+
+	}
+
+	return best;
+
+}
+
+/**
+ * Starts writing consecutive sectors of a volume, without waiting.
+ * A striped volume keeps sector s on member s % numMembers, at sector
+ * s / numMembers of that disk. A run of sectors then covers a run on
+ * each member, so each member gets one request and they work at once.
+ * A mirrored volume writes every member, all at once.
+ * Parameters:
+ * volumeID: the disk the volume was formatted on.
+ * sector: the first sector to write to.
+ * count: how many sectors to write. At most MAX_DISK_IO_VECTOR.
+ * buffers: the outgoing data, one buffer per sector.
+ * requests: where to put the requests made. Room is needed
+ * for one per member.
+ * Returns how many requests were made. Each must be waited for.
+ */
+int submitVolumeWrite(long volumeID, long sector, int count, char** buffers, DiskRequest** requests) {
+
+	Volume* volume = &volumes[volumeID];
+
+	if(volume->type == VOLUME_MIRRORED) {
+
+		for(int i = 0; i < volume->numMembers; i++) {
+			requests[i] = submitDiskVector(volume->members[i], Z502DiskWrite, sector, count, buffers);
+		}
+
+		return volume->numMembers;
+
+	}
+
+	if(volume->numMembers == 1) {
+		requests[0] = submitDiskVector(volume->members[0], Z502DiskWrite, sector, count, buffers);
+		return 1;
+	}
+
+	int numMembers = volume->numMembers;
+	int numRequests = 0;
+
+	for(int i = 0; i < numMembers && i < count; i++) {
+
+		//the sectors of the run on this member are every
+		//numMembers'th one, starting from the i'th.
+		long first = sector + i;
+		char* memberBuffers[MAX_DISK_IO_VECTOR];
+		int memberCount = 0;
+
+		for(int j = i; j < count; j += numMembers) {
+			memberBuffers[memberCount++] = buffers[j];
+		}
+
+		requests[numRequests++] = submitDiskVector(volume->members[first % numMembers],
+				Z502DiskWrite, first / numMembers, memberCount, memberBuffers);
+
+	}
+
+	return numRequests;
+
+}
+
+/**
+ * Writes a sector of a volume. See submitVolumeWrite.
+ * Parameters:
+ * volumeID: the disk the volume was formatted on.
+ * sector: the sector to write to.
+ * writeBuffer: the address of outgoing data.
+ */
+void writeToVolume(long volumeID, long sector, char* writeBuffer) {
+
+	DiskRequest* writes[MAX_NUMBER_OF_DISKS];
+	int numWrites = submitVolumeWrite(volumeID, sector, 1, &writeBuffer, writes);
+
+	for(int i = 0; i < numWrites; i++) {
+		waitForDiskRequest(writes[i]);
+	}
+
+}
+
+/**
+ * Reads a sector of a volume, from the member
+ * that holds it, or from the best mirror.
+ * Parameters:
+ * volumeID: the disk the volume was formatted on.
+ * sector: the sector to read from.
+ * readBuffer: the address to send the data to.
+ */
+void readFromVolume(long volumeID, long sector, char* readBuffer) {
+
+	Volume* volume = &volumes[volumeID];
+
+	if(volume->type == VOLUME_MIRRORED) {
+		readFromDisk(chooseMirror(volume, sector), sector, readBuffer);
+	} else {
+		readFromDisk(volume->members[sector % volume->numMembers],
+				sector / volume->numMembers, readBuffer);
+	}
+
+}
@@ -0,0 +1,48 @@
+/*
+ * volumeManager.h
+ *
+ *  Created on: Oct 24, 2019
+ *      Author: jean-philippe
+ */
+//intended to contain volumes: the disk a file system is
+//formatted on, seen as one or more member disks.
+//file data goes through a volume so it can be spread
+//over several disks that work in parallel.
+
+#ifndef VOLUMEMANAGER_H_
+#define VOLUMEMANAGER_H_
+
+#include "global.h"
+#include "moreGlobals.h"
+
+//kinds of volume.
+#define VOLUME_SINGLE 0 //just the disk itself.
+#define VOLUME_STRIPED 1 //sectors go round-robin over the members.
+#define VOLUME_MIRRORED 2 //every member holds every sector.
+
+//struct for a volume.
+//type: one of the VOLUME_ kinds.
+//numMembers: how many disks make up the volume.
+//members: the member disks. the first is the disk the volume is named after.
+struct Volume {
+	int type;
+	int numMembers;
+	long members[MAX_NUMBER_OF_DISKS];
+};
+
+typedef struct Volume Volume;
+
+//one volume for each disk a file system can be formatted on.
+Volume volumes[MAX_NUMBER_OF_DISKS];
+
+int stripeWidth; //how many disks FORMAT stripes a volume over. 1 for no striping.
+int mirrorVolumes; //whether FORMAT mirrors a volume onto the next disk.
+
+void initVolumes();
+void createVolume(long diskID);
+long chooseMirror(Volume* volume, long sector);
+int submitVolumeWrite(long volumeID, long sector, int count, char** buffers, DiskRequest** requests);
+void writeToVolume(long volumeID, long sector, char* writeBuffer);
+void readFromVolume(long volumeID, long sector, char* readBuffer);
+
+#endif /* VOLUMEMANAGER_H_ */
@@ -103,6 +103,7 @@
 //  Prototypes that allow the OS to get to this hardware are in protos.h
 
 void AddEventToInterruptQueue(INT32, INT16, INT16, EVENT **);
+void AddTaggedEventToInterruptQueue(INT32, INT16, INT16, INT32, EVENT **);
 void AssociateContextWithProcess(Z502CONTEXT *Context);
 void ChargeTimeAndCheckEvents(INT32);
 int CreateAThread(void *ThreadStartAddress, INT32 *data);
@@ -115,6 +116,9 @@ void DoMemoryDebug(INT16, INT16);
 void DoSleep(INT32 millisecs);
 Z502CONTEXT *GetCurrentContext();
 int GetLock(UINT32 RequestedMutex, char *CallingRoutine);
+unsigned long long GetLockClockNanosecs();
+void RecordLockAcquired(UINT32 RequestedMutex, unsigned long long WaitStart);
+void RecordLockReleased(UINT32 RequestedMutex, unsigned long long HeldSince);
 INT16 GetMode(char *CallerLocation);
 void GetNextEventTime(INT32 *);
 UINT16 *GetPageTableAddress();
@@ -124,7 +128,7 @@ void GetProcessTimeUsage( unsigned long long *,
 		          unsigned long long *);
 void GetSectorStructure(INT16, INT16, char **, INT32 *);
 unsigned long GetTotalNumberOfLocks();
-void GetNextOrderedEvent(INT32 *, INT16 *, INT16 *, INT32 *);
+void GetNextOrderedEvent(INT32 *, INT16 *, INT16 *, INT32 *, INT32 *);
 int GetMyTid();
 int GetTryLock(UINT32 RequestedMutex, char *CallingRoutine);
 void GoToExit(int);
@@ -132,8 +136,13 @@ void HaltSimulation();
 void HandleWindowsError();
 void HardwareClock(INT32 *);
 void HardwareTimer(INT32);
-void HardwareReadDisk(INT16, INT16, char *);
-void HardwareWriteDisk(INT16, INT16, char *);
+INT32 HardwareReadDisk(INT16, INT16, char *);
+INT32 HardwareWriteDisk(INT16, INT16, char *);
+INT32 HardwareVectorDisk(INT16, INT16, DISK_IO_VECTOR *, BOOL);
+INT32 HardwareSetDiskTiming(INT16, DISK_TIMING *);
+INT32 DiskAccessTime(INT16, DISK_COMMAND *);
+void StartDiskCommand(INT16, DISK_COMMAND *);
+BOOL StartNextQueuedDiskCommand(INT16);
 void HardwareCheckDisk(int DiskID);
 void HardwareInterrupt(void);
 void HardwareFault(INT16, INT16);
@@ -151,6 +160,8 @@ void PrintLockDebug(int Action, char *LockCaller, int Mutex, int Return);
 void PrintThreadTable(char *Explanation);
 int ReleaseLock(UINT32 RequestedMutex, char* CallingRoutine);
 void ResumeProcessExecution(Z502CONTEXT *Context);
+BOOL RetireContext(Z502CONTEXT *Context);
+void ProcessCodeReturned(void);
 void SaveTimeOfCall(int SystemCallNumber);
 void SetCurrentContext(Z502CONTEXT *Address);
 void SetMode(char *CallerLocation, INT16 mode);
@@ -239,6 +250,7 @@ HANDLE LocalEvent[100];
 
 #if defined LINUX || defined MAC
 pthread_mutex_t LocalMutex[300];
+LOCK_STATS     LockStats[300];
 //pthread_cond_t LocalCondition[100];
 sem_t          *Semaphore[100];
 int            NextMutexToAllocate = 0;
@@ -593,6 +605,7 @@ void MemoryMappedIO(INT32 address, MEMORY_MAPPED_IO *mmio, BOOL ReadOrWrite) {
                         && (STAT_VECTOR[SV_TID ][index] == GetMyTid())) {
                     mmio->Field1 = index;                         // Device ID
                     mmio->Field2 = STAT_VECTOR[SV_VALUE ][index]; // Device Status
+                    mmio->Field3 = STAT_VECTOR[SV_TAG ][index];   // Disk request tag
                     STAT_VECTOR[SV_VALUE ][index] = 0;  // Invalidate the record
                     STAT_VECTOR[SV_ACTIVE ][index] = 0;
                     STAT_VECTOR[SV_TID ][index] = 0;
@@ -654,6 +667,7 @@ void MemoryMappedIO(INT32 address, MEMORY_MAPPED_IO *mmio, BOOL ReadOrWrite) {
                     mmio->Field2 = DEVICE_IN_USE;
                 else
                     mmio->Field2 = DEVICE_FREE;
+                mmio->Field3 = DiskState[mmio->Field1].LastSector; // Head position
                 mmio->Field4 = ERR_SUCCESS;
             } else {
                 mmio->Field4 = ERR_BAD_DEVICE_ID;  //Not a legal disk number
@@ -675,16 +689,29 @@ void MemoryMappedIO(INT32 address, MEMORY_MAPPED_IO *mmio, BOOL ReadOrWrite) {
                 mmio->Field4 = ERR_BAD_PARAM;
                 break;
             }
+            // The request's tag comes back in Field2
             if (mmio->Mode == Z502DiskRead) {
-                HardwareReadDisk((INT16) mmio->Field1, mmio->Field2,
+                mmio->Field2 = HardwareReadDisk((INT16) mmio->Field1, mmio->Field2,
                         (char *) mmio->Field3);
                 break;
             }
             if (mmio->Mode == Z502DiskWrite) {
-                HardwareWriteDisk((INT16) mmio->Field1, mmio->Field2,
+                mmio->Field2 = HardwareWriteDisk((INT16) mmio->Field1, mmio->Field2,
                         (char *) mmio->Field3);
                 break;
             }
+            if (mmio->Mode == Z502DiskSetTiming) {
+                mmio->Field4 = HardwareSetDiskTiming((INT16) mmio->Field1,
+                        (DISK_TIMING *) mmio->Field3);
+                break;
+            }
+            if (mmio->Mode == Z502DiskReadVector
+                    || mmio->Mode == Z502DiskWriteVector) {
+                mmio->Field2 = HardwareVectorDisk((INT16) mmio->Field1, mmio->Field2,
+                        (DISK_IO_VECTOR *) mmio->Field3,
+                        mmio->Mode == Z502DiskWriteVector);
+                break;
+            }
         }
         // We get here only if there's a confusion
         if (DO_DEVICE_DEBUG) {
@@ -707,6 +734,22 @@ void MemoryMappedIO(INT32 address, MEMORY_MAPPED_IO *mmio, BOOL ReadOrWrite) {
               &&  (mmio->Field2 != START_NEW_CONTEXT_AND_SUSPEND) )  {
                 mmio->Field4 = ERR_BAD_PARAM;
             }
+            // Field3 optionally names the processor the context is
+            // placed on.  Out of range values carry no placement.
+            // A context started on a different processor than last
+            // time has migrated.
+            if (  (mmio->Field2 != SUSPEND_CURRENT_CONTEXT_ONLY)
+              &&  (mmio->Field1 != 0)
+              &&  (mmio->Field3 >= 0)
+              &&  (mmio->Field3 < Z502_CURRENT_NUMBER_OF_PROCESSORS) ) {
+                Z502CONTEXT *Placed = (Z502CONTEXT *) mmio->Field1;
+                if (Placed->StructureID == CONTEXT_STRUCTURE_ID) {
+                    if ( (Placed->LastProcessor != -1)
+                      && (Placed->LastProcessor != mmio->Field3) )
+                        HardwareStats.Migrations++;
+                    Placed->LastProcessor = (INT16) mmio->Field3;
+                }
+            }
             // We return from this call as a different thread, so we
             // can't hold a lock across this transition
             ReleaseLock(HardwareLock, "StartContext");
@@ -727,6 +770,16 @@ void MemoryMappedIO(INT32 address, MEMORY_MAPPED_IO *mmio, BOOL ReadOrWrite) {
             break;
         }  // End of Mode == InitializeContext
 
+        // A destroyed context can't be started again.  Its thread
+        // gives up whatever it was doing and waits for a new context.
+        if (mmio->Mode == Z502DestroyContext) {
+            if (RetireContext((Z502CONTEXT *) mmio->Field1))
+                mmio->Field4 = ERR_SUCCESS;
+            else
+                mmio->Field4 = ERR_BAD_PARAM;
+            break;
+        }  // End of Mode == DestroyContext
+
         if (mmio->Mode == Z502GetPageTable) {
             mmio->Field1 = (long) GetPageTableAddress();
             mmio->Field4 = ERR_SUCCESS;      // Error code
@@ -856,134 +909,260 @@ void Z502WritePhysicalMemory(INT32 PhysicalPageNumber,
 /*************************************************************************
  HardwareReadDisk
 
- This code simulates a disk read.  Actions include:
- o If not in KERNEL_MODE, then cause priv inst trap.
- o Do range check on disk_id, sector; give
- interrupt error = ERR_BAD_PARAM if illegal.
- o If an event for this disk already exists ( the disk
- is already busy ), then give interrupt error ERR_DISK_IN_USE.
- o Search for sector structure off of hashed value.
- o If search fails give interrupt error = ERR_NO_PREVIOUS_WRITE
- o Copy data from sector to buffer.
- o From DiskState information, determine how long this request will take.
- o Request a future interrupt for this event.
- o Advance time and see if an interrupt has occurred.
+ This code simulates a disk read.  It's a vectored read of one sector -
+ see HardwareVectorDisk for what happens.
+ Returns the tag the disk gave the request.
 
  **************************************************************************/
-void HardwareReadDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
-    INT32 local_error;
-    char *sector_ptr = 0;
-    INT32 access_time;
-    INT16 error_found;
+INT32 HardwareReadDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
+    DISK_IO_VECTOR vector;
 
-    error_found = 0;
-    // We need to be in kernel mode or be in interrupt handler
-    if (GetMode("HardwareReadDisk1") != KERNEL_MODE && InterruptTid != GetMyTid()) {
-        HardwareFault(PRIVILEGED_INSTRUCTION, 0);
-        return;
-    }
-    // This SHOULD have been checked in MemoryMappedIO
-    if (disk_id < 0 || disk_id >= MAX_NUMBER_OF_DISKS) {
-        disk_id = 0; /* To aim at legal vector  */
-        error_found = ERR_BAD_PARAM;
-    }
+    vector.SectorCount = 1;
+    vector.Buffers[0] = buffer_ptr;
+    return HardwareVectorDisk(disk_id, sector, &vector, FALSE);
+}               // End of HardwareReadDisk
 
-    if (sector < 0 || sector >= NUMBER_LOGICAL_SECTORS)
-        error_found = ERR_BAD_PARAM;
+/*****************************************************************
+ HardwareWriteDisk
 
-    if (error_found == 0) {
-        GetSectorStructure(disk_id, sector, &sector_ptr, &local_error);
-        if (local_error != 0)
-            error_found = ERR_NO_PREVIOUS_WRITE;
+ This code simulates a disk write.  It's a vectored write of one sector -
+ see HardwareVectorDisk for what happens.
+ Returns the tag the disk gave the request.
 
-        if (DiskState[disk_id].DiskInUse == TRUE)
-            error_found = ERR_DISK_IN_USE;
-    }
+ *****************************************************************/
+INT32 HardwareWriteDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
+    DISK_IO_VECTOR vector;
 
-    /* If we found an error, add an event that will cause an immediate
-     hardware interrupt.                                              */
+    vector.SectorCount = 1;
+    vector.Buffers[0] = buffer_ptr;
+    return HardwareVectorDisk(disk_id, sector, &vector, TRUE);
+}                           // End of HardwareWriteDisk
 
-    if (error_found != 0) {
-        if (DO_DEVICE_DEBUG) {
-            aprintf("--- BEGIN DO_DEVICE DEBUG - IN read_disk ----- \n");
-            aprintf("ERROR:  Something screwed up   The error\n");
-            aprintf("      code is %d that you can look up in global.h\n",
-                    error_found);
-            aprintf("     The disk will cause an interrupt to tell \n");
-            aprintf("      you about that error.\n");
-            aprintf("--- END DO_DEVICE DEBUG - ---------------------\n");
-        }
-        AddEventToInterruptQueue(CurrentSimulationTime,
-                (INT16) (DISK_INTERRUPT + disk_id), error_found,
-                &DiskState[disk_id].EventPtr);
-    } else {
-        //memcpy(buffer_ptr, sector_ptr, PGSIZE);   // Bugfix 07/2014
-        DiskState[disk_id].Destination = buffer_ptr;
-        DiskState[disk_id].Source = sector_ptr;
-        access_time = CurrentSimulationTime + 100
-                + abs(DiskState[disk_id].LastSector - sector) / 20;
-        HardwareStats.DiskReads[disk_id]++;
-        HardwareStats.DiskBusyTime[disk_id] += access_time
-                - CurrentSimulationTime;
-        if (DO_DEVICE_DEBUG) {
-            aprintf("\nDEVICE_DEBUG: Time = %d: ", CurrentSimulationTime);
-            aprintf("  Disk %d READ will interrupt at time = %d\n", disk_id,
-                    access_time);
-        }
-        AddEventToInterruptQueue(access_time,
-                (INT16) (DISK_INTERRUPT + disk_id), (INT16) ERR_SUCCESS,
-                &DiskState[disk_id].EventPtr);
-        DiskState[disk_id].LastSector = sector;
-    }
-    DiskState[disk_id].DiskInUse = TRUE;
-    // aprintf("1. Setting %d TRUE\n", disk_id );
-    ChargeTimeAndCheckEvents(COST_OF_DISK_ACCESS);
+/*****************************************************************
+ HardwareSetDiskTiming
 
-}               // End of HardwareReadDisk
+ Gives a disk a new timing model - see DISK_TIMING in global.h.
+ Requests the disk has already started keep the time they were given.
+ Returns ERR_SUCCESS, or ERR_BAD_PARAM if the model is unknown or
+ its parameters can't be used.
+ Called from MemoryMappedIO, so the HardwareLock is held.
+
+ *****************************************************************/
+INT32 HardwareSetDiskTiming(INT16 disk_id, DISK_TIMING *timing) {
+	BOOL legal;
+
+	if (disk_id < 0 || disk_id >= MAX_NUMBER_OF_DISKS)
+		return ERR_BAD_DEVICE_ID;
+
+	legal = timing->AccessTime >= 0;
+	switch (timing->Model) {
+	case DISK_TIMING_LINEAR:
+		legal = legal && timing->SeekDivisor > 0 && timing->TransferTime >= 0;
+		break;
+	case DISK_TIMING_ROTATIONAL:
+		legal = legal && timing->SeekTime >= 0 && timing->SectorsPerTrack > 0
+				&& timing->RotationTime >= timing->SectorsPerTrack;
+		break;
+	case DISK_TIMING_FLASH:
+		legal = legal && timing->Channels > 0 && timing->TransferTime >= 0;
+		break;
+	default:
+		legal = FALSE;
+	}
+	if (!legal)
+		return ERR_BAD_PARAM;
+
+	DiskState[disk_id].Timing = *timing;
+	if (DO_DEVICE_DEBUG) {
+		aprintf("\nDEVICE_DEBUG: Disk %d now uses timing model %ld\n",
+				disk_id, timing->Model);
+	}
+	return ERR_SUCCESS;
+}                           // End of HardwareSetDiskTiming
 
 /*****************************************************************
- HardwareWriteDisk
+ DiskAccessTime
+
+ Works out how long a command will take if the disk starts it now,
+ from where the head is and the disk's timing model.
+
+ *****************************************************************/
+INT32 DiskAccessTime(INT16 disk_id, DISK_COMMAND *command) {
+	DISK_TIMING *timing = &DiskState[disk_id].Timing;
+	INT32 SeekDone;
+	INT32 UnderHead;
+	INT32 Target;
+	INT32 PerTrack;
+
+	switch (timing->Model) {
+	case DISK_TIMING_ROTATIONAL:
+		PerTrack = timing->SectorsPerTrack;
+		SeekDone = CurrentSimulationTime + timing->AccessTime
+				+ abs(DiskState[disk_id].LastSector / PerTrack
+						- command->Sector / PerTrack) * timing->SeekTime;
+		// Which sector of the track is passing under the head as the seek ends
+		UnderHead = (SeekDone % timing->RotationTime) * PerTrack
+				/ timing->RotationTime;
+		Target = command->Sector % PerTrack;
+		return SeekDone - CurrentSimulationTime
+				+ ((Target - UnderHead + PerTrack) % PerTrack)
+						* timing->RotationTime / PerTrack
+				+ command->Count * timing->RotationTime / PerTrack;
+	case DISK_TIMING_FLASH:
+		return timing->AccessTime
+				+ ((command->Count + timing->Channels - 1) / timing->Channels)
+						* timing->TransferTime;
+	default:
+		return timing->AccessTime
+				+ abs(DiskState[disk_id].LastSector - command->Sector)
+						/ timing->SeekDivisor
+				+ (command->Count - 1) * timing->TransferTime;
+	}
+}                           // End of DiskAccessTime
+
+/*****************************************************************
+ StartDiskCommand
+
+ Puts a command on the disk's head.  The disk must be idle.
+ o From DiskState information, determine how long this request will
+ take - see DiskAccessTime.
+ o Request a future interrupt, tagged with the command's tag.
+ The caller holds the HardwareLock.
+
+ *****************************************************************/
+void StartDiskCommand(INT16 disk_id, DISK_COMMAND *command) {
+	INT32 access_time;
+	INT16 Index;
+
+	for (Index = 0; Index < command->Count; Index++) {
+		DiskState[disk_id].Source[Index] = command->Source[Index];
+		DiskState[disk_id].Destination[Index] = command->Destination[Index];
+	}
+	DiskState[disk_id].TransferCount = command->Count;
+	DiskState[disk_id].CurrentTag = command->Tag;
+
+	access_time = (INT32) CurrentSimulationTime
+			+ DiskAccessTime(disk_id, command);
+	if (command->IsWrite)
+		HardwareStats.DiskWrites[disk_id]++;
+	else
+		HardwareStats.DiskReads[disk_id]++;
+	HardwareStats.DiskBusyTime[disk_id] += access_time
+			- CurrentSimulationTime;
+	if (DO_DEVICE_DEBUG) {
+		aprintf("\nDEVICE_DEBUG: Time = %d:  ", CurrentSimulationTime);
+		aprintf("Disk %d %s of %d sectors (tag %d) will interrupt at time = %d\n",
+				disk_id, command->IsWrite ? "WRITE" : "READ", command->Count,
+				command->Tag, access_time);
+	}
+	AddTaggedEventToInterruptQueue(access_time,
+			(INT16) (DISK_INTERRUPT + disk_id), (INT16) ERR_SUCCESS,
+			command->Tag, &DiskState[disk_id].EventPtr);
+	DiskState[disk_id].LastSector = command->Sector + command->Count - 1;
+	DiskState[disk_id].DiskInUse = TRUE;
+}                           // End of StartDiskCommand
+
+/*****************************************************************
+ StartNextQueuedDiskCommand
+
+ Called when a disk finishes a command.  The disk holds up to
+ DISK_QUEUE_DEPTH - 1 commands behind the one it's working on, and
+ serves the one whose first sector is closest to the head next.
+ Returns TRUE if a command was started.
+
+ *****************************************************************/
+BOOL StartNextQueuedDiskCommand(INT16 disk_id) {
+	INT16 Index;
+	INT16 Closest = -1;
+	INT32 ClosestDistance = 0;
+	INT32 Distance;
+	DISK_COMMAND command;
+
+	for (Index = 0; Index < DiskState[disk_id].NumberQueued; Index++) {
+		Distance = abs(DiskState[disk_id].LastSector
+				- DiskState[disk_id].Queued[Index].Sector);
+		if (Closest == -1 || Distance < ClosestDistance) {
+			Closest = Index;
+			ClosestDistance = Distance;
+		}
+	}
+	if (Closest == -1)
+		return FALSE;
+
+	command = DiskState[disk_id].Queued[Closest];
+	DiskState[disk_id].NumberQueued--;
+	DiskState[disk_id].Queued[Closest] =
+			DiskState[disk_id].Queued[DiskState[disk_id].NumberQueued];
+	StartDiskCommand(disk_id, &command);
+	return TRUE;
+}                           // End of StartNextQueuedDiskCommand
 
- This code simulates a disk write.  Actions include:
+/*****************************************************************
+ HardwareVectorDisk
+
+ This code simulates a read or write of one or more consecutive
+ sectors.  Actions include:
  o If not in KERNEL_MODE, then cause priv inst trap.
- o Do range check on disk_id, sector; give interrupt error
- = ERR_BAD_PARAM if illegal.
- o If an event for this disk already exists ( the disk is already busy ),
- then give interrupt error ERR_DISK_IN_USE.
- o Search for sector structure off of hashed value.
- o If search fails give create a sector on the simulated disk.
- o Copy data from buffer to sector.
- o From DiskState information, determine how long this request will take.
- o Request a future interrupt for this event.
+ o Do range check on disk_id, sector and SectorCount; give
+ interrupt error = ERR_BAD_PARAM if illegal.
+ o For a read, search for the structure of each sector.
+ If search fails give interrupt error = ERR_NO_PREVIOUS_WRITE
+ o For a write, create any sector structures that don't exist yet.
+ o Give the request a tag.  Every interrupt for this request
+ carries that tag.
+ o If the disk is idle, start the request.  If it's busy, queue the
+ request on the disk, up to DISK_QUEUE_DEPTH requests in all.  If
+ that queue is full, give interrupt error ERR_DISK_IN_USE.
  o Advance time and see if an interrupt has occurred.
+ Data is copied when the request's interrupt happens.
+ Returns the tag given to the request.
 
  *****************************************************************/
-void HardwareWriteDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
+INT32 HardwareVectorDisk(INT16 disk_id, INT16 sector, DISK_IO_VECTOR *vector,
+		BOOL is_write) {
 	INT32 local_error;
 	char *sector_ptr;
-	INT32 access_time;
 	INT16 error_found;
+	INT16 count;
+	INT16 Index;
+	DISK_COMMAND command;
+	EVENT *error_event;
 
 	error_found = 0;
 	// We need to be in kernel mode or be in interrupt handler
-	if (GetMode("HardwareWriteDisk1") != KERNEL_MODE && InterruptTid != GetMyTid()) {
+	if (GetMode("HardwareVectorDisk1") != KERNEL_MODE && InterruptTid != GetMyTid()) {
 		HardwareFault(PRIVILEGED_INSTRUCTION, 0);
-		return;
+		return 0;
 	}
 
 	if (disk_id < 0 || disk_id >= MAX_NUMBER_OF_DISKS) {
-		disk_id = 1; /* To aim at legal vector  */
+		disk_id = 0; /* To aim at legal vector  */
 		error_found = ERR_BAD_PARAM;
 	}
-	if (sector < 0 || sector >= NUMBER_LOGICAL_SECTORS)
+	count = (INT16) vector->SectorCount;
+	if (count < 1 || count > MAX_DISK_IO_VECTOR)
+		error_found = ERR_BAD_PARAM;
+	if (sector < 0 || sector + count > NUMBER_LOGICAL_SECTORS)
 		error_found = ERR_BAD_PARAM;
 
-	if (DiskState[disk_id].DiskInUse == TRUE)
+	if (error_found == 0 && !is_write) {
+		for (Index = 0; Index < count; Index++) {
+			GetSectorStructure(disk_id, sector + Index, &sector_ptr,
+					&local_error);
+			if (local_error != 0)
+				error_found = ERR_NO_PREVIOUS_WRITE;
+		}
+	}
+
+	if (DiskState[disk_id].DiskInUse == TRUE
+			&& DiskState[disk_id].NumberQueued >= DISK_QUEUE_DEPTH - 1)
 		error_found = ERR_DISK_IN_USE;
 
+	command.Tag = ++DiskState[disk_id].NextTag;
+
 	if (error_found != 0) {
 		if (DO_DEVICE_DEBUG) {
-			aprintf("---- BEGIN DO_DEVICE DEBUG - IN write_disk --- \n");
+			aprintf("---- BEGIN DO_DEVICE DEBUG - IN vector_disk -- \n");
 			aprintf("ERROR:  in your disk request.  The error\n");
 			aprintf("     code is %d that you can look up in global.h\n",
 					error_found);
@@ -991,39 +1170,40 @@ void HardwareWriteDisk(INT16 disk_id, INT16 sector, char *buffer_ptr) {
 			aprintf("     you about that error.\n");
 			aprintf("---- END DO_DEVICE DEBUG - --------------------\n");
 		}
-		AddEventToInterruptQueue(CurrentSimulationTime,
+		// The error interrupt belongs to the rejected request alone, so it
+		// leaves the disk's state - and any command it's running - alone.
+		AddTaggedEventToInterruptQueue(CurrentSimulationTime,
 				(INT16) (DISK_INTERRUPT + disk_id), error_found,
-				&DiskState[disk_id].EventPtr);
+				command.Tag, &error_event);
 	} else {
-		GetSectorStructure(disk_id, sector, &sector_ptr, &local_error);
-		if (local_error != 0) /* No structure for this sector exists */
-			CreateSectorStruct(disk_id, sector, &sector_ptr);
-
-		//memcpy(sector_ptr, buffer_ptr, PGSIZE); // Bugfix 07/2014
-		DiskState[disk_id].Destination = sector_ptr;
-		DiskState[disk_id].Source = buffer_ptr;
+		command.Sector = sector;
+		command.Count = count;
+		command.IsWrite = is_write;
+		for (Index = 0; Index < count; Index++) {
+			GetSectorStructure(disk_id, sector + Index, &sector_ptr,
+					&local_error);
+			if (is_write) {
+				if (local_error != 0)
+					CreateSectorStruct(disk_id, sector + Index, &sector_ptr);
+				command.Destination[Index] = sector_ptr;
+				command.Source[Index] = vector->Buffers[Index];
+			} else {
+				command.Destination[Index] = vector->Buffers[Index];
+				command.Source[Index] = sector_ptr;
+			}
+		}
 
-		access_time = (INT32) CurrentSimulationTime + 100
-				+ abs(DiskState[disk_id].LastSector - sector) / 20;
-		HardwareStats.DiskWrites[disk_id]++;
-		HardwareStats.DiskBusyTime[disk_id] += access_time
-				- CurrentSimulationTime;
-		if (DO_DEVICE_DEBUG) {
-			aprintf("\nDEVICE_DEBUG: Time = %d:  ", CurrentSimulationTime);
-			aprintf("Disk %d WRITE will cause interrupt at time = %d\n", disk_id,
-					access_time);
+		if (DiskState[disk_id].DiskInUse == TRUE) {
+			DiskState[disk_id].Queued[DiskState[disk_id].NumberQueued] = command;
+			DiskState[disk_id].NumberQueued++;
+		} else {
+			StartDiskCommand(disk_id, &command);
 		}
-		AddEventToInterruptQueue(access_time,
-				(INT16) (DISK_INTERRUPT + disk_id), (INT16) ERR_SUCCESS,
-				&DiskState[disk_id].EventPtr);
-		DiskState[disk_id].LastSector = sector;
 	}
-	// No matter if the disk request succeeds or fails, the disk is set as busy
-	DiskState[disk_id].DiskInUse = TRUE;
-	// aprintf("2. Setting %d TRUE\n", disk_id );
 	ChargeTimeAndCheckEvents(COST_OF_DISK_ACCESS);
+	return command.Tag;
 
-}                           // End of HardwareWriteDisk
+}                           // End of HardwareVectorDisk
 
 /*****************************************************************
  HardwareCheckDisk()
@@ -1307,6 +1487,7 @@ void MakeContext(long *ReturningContextPointer, long starting_address,
 	our_ptr->CodeEntry = (void *) starting_address;
 	our_ptr->PageTablePointer = (void *) PageTable;
 	our_ptr->ContextStartCount = 0;
+	our_ptr->LastProcessor = -1;
 	// our_ptr->program_mode = user_or_kernel;    BUGFIX  4.10 - July 2014
 	our_ptr->ProgramMode = KERNEL_MODE;  // Always start process in Kernel Mode
 	our_ptr->FaultInProgress = FALSE;
@@ -1701,9 +1882,11 @@ void HardwareInterrupt(void) {
     INT32 time_of_event;
     INT16 event_type;
     INT16 event_error;
+    INT32 event_tag;
     INT32 local_error;
     INT32 TimeToWaitForCondition = 30; // Millisecs before Condition will go off
     INT32 *DataPointer;
+    INT16 Index;
     // void (*InterruptHandler)(void);
 
     InterruptTid = GetMyTid();
@@ -1728,7 +1911,7 @@ void HardwareInterrupt(void) {
         GetLock(HardwareLock, "HardwareInterrupt-2");
         NumberOfInterruptsStarted++;
         GetNextOrderedEvent(&time_of_event, &event_type, &event_error,
-                &local_error);
+                &event_tag, &local_error);
         if (local_error != 0) {
             aprintf("In HardwareInterrupt we expected to find an event;\n");
             aprintf("A timer or disk interrupt we are to act upon.");
@@ -1746,8 +1929,10 @@ void HardwareInterrupt(void) {
             // the case that we now have the ERR_DISK_BUSY handled here but
             // the first (original) disk request has already cleared the
             // DiskInUse flag.    Rev 4.50, 04/2018
+            // An error interrupt is for a request the disk turned away, so
+            // the disk may well be idle - or busy with something else.
             if ((DiskState[event_type - DISK_INTERRUPT ].DiskInUse == FALSE)
-                       & ( event_error != ERR_DISK_IN_USE ))  {
+                       && ( event_error == ERR_SUCCESS ))  {
             aprintf("False interrupt - the Z502 got an interrupt from a\n");
             aprintf("DISK - but that disk wasn't in use.\n");
             aprintf("This often happens if your disk has had an error.\n");
@@ -1757,19 +1942,23 @@ void HardwareInterrupt(void) {
             }
 
             //  We MAYBE should be clearing all these as well - and not just the current one.
-            memcpy(DiskState[event_type - DISK_INTERRUPT ].Destination, // Bugfix 07/2014
-                    DiskState[event_type - DISK_INTERRUPT ].Source, PGSIZE);
+            if ( event_error == ERR_SUCCESS ) {
+                for (Index = 0; Index < DiskState[event_type - DISK_INTERRUPT ].TransferCount; Index++) {
+                    memcpy(DiskState[event_type - DISK_INTERRUPT ].Destination[Index], // Bugfix 07/2014
+                            DiskState[event_type - DISK_INTERRUPT ].Source[Index], PGSIZE);
+                }
+            }
             if (DO_DEVICE_DEBUG) {
                 DataPointer =
-                        (INT32 *) DiskState[event_type - DISK_INTERRUPT ].Source;
+                        (INT32 *) DiskState[event_type - DISK_INTERRUPT ].Source[0];
                 aprintf(
                         "\nDEVICE_DEBUG: HardwareInterrupt - Moving Disk data\n");
                 aprintf("DEVICE_DEBUG:    Source Addr = %lX  ",
                         (unsigned long) DiskState[event_type - DISK_INTERRUPT
-                                + 1].Source);
+                                + 1].Source[0]);
                 aprintf("Dest Addr = %lX\n",
                         (unsigned long) DiskState[event_type - DISK_INTERRUPT
-                                + 1].Destination);
+                                + 1].Destination[0]);
                 aprintf("DEVICE_DEBUG:    Contents = %d  ", DataPointer[0]);
                 aprintf("%d  ", DataPointer[1]);
                 aprintf("%d  ", DataPointer[2]);
@@ -1782,11 +1971,15 @@ void HardwareInterrupt(void) {
             // immediately.  If that second request tries to clear the DiskInUse flag, then when
             // the FIRST request gets here, it will take a fatal error above since we got an
             // interrupt for a disk not in use.
-            if ( event_error != ERR_DISK_IN_USE ) {
-                DiskState[event_type - DISK_INTERRUPT ].DiskInUse = FALSE;
-                        }
+            // A disk that finishes a request moves straight on to the next
+            // one it holds, so it stays in use.
+            // Only the running command's own interrupt changes the disk's state.
+            if ( event_error == ERR_SUCCESS ) {
+                DiskState[event_type - DISK_INTERRUPT ].EventPtr = NULL;
+                if ( !StartNextQueuedDiskCommand(event_type - DISK_INTERRUPT) )
+                    DiskState[event_type - DISK_INTERRUPT ].DiskInUse = FALSE;
+            }
             // aprintf("3. Setting %d FALSE\n", event_type );
-            DiskState[event_type - DISK_INTERRUPT ].EventPtr = NULL;
         }
 
         if (event_type == TIMER_INTERRUPT && event_error == ERR_SUCCESS) {
@@ -1813,6 +2006,7 @@ void HardwareInterrupt(void) {
          *        here is set the flag [SV_VALUE] saying the record is valid.
          ******************************************************************************/
         STAT_VECTOR[SV_VALUE ][event_type] = event_error;
+        STAT_VECTOR[SV_TAG ][event_type] = event_tag;
         STAT_VECTOR[SV_TID ][event_type] = GetMyTid(); // This is Interrupt Thread
         STAT_VECTOR[SV_ACTIVE ][event_type] = 1;
 
@@ -1970,6 +2164,22 @@ void HardwareInternalPanic(INT32 panic_type) {
 
 void AddEventToInterruptQueue(INT32 time_of_event, INT16 event_type,
 		INT16 event_error, EVENT **returned_event_ptr) {
+	AddTaggedEventToInterruptQueue(time_of_event, event_type, event_error,
+			0, returned_event_ptr);
+}             // End of  AddEventToInterruptQueue
+
+/*****************************************************************
+
+ AddTaggedEventToInterruptQueue()
+
+ Adds an event that carries a tag - for a disk, the tag of the
+ request that the event finishes.  The tag is handed to the OS
+ along with the interrupt.
+
+ *****************************************************************/
+
+void AddTaggedEventToInterruptQueue(INT32 time_of_event, INT16 event_type,
+		INT16 event_error, INT32 event_tag, EVENT **returned_event_ptr) {
 	EVENT *ep;
 	EVENT *temp_ptr;
 	EVENT *last_ptr;
@@ -2000,6 +2210,7 @@ void AddEventToInterruptQueue(INT32 time_of_event, INT16 event_type,
 	ep->structure_id = EVENT_STRUCTURE_ID;
 	ep->event_type = event_type;
 	ep->event_error = event_error;
+	ep->event_tag = event_tag;
 	*returned_event_ptr = ep;
 	if (DO_DEVICE_DEBUG) {
 		aprintf(
@@ -2049,7 +2260,7 @@ void AddEventToInterruptQueue(INT32 time_of_event, INT16 event_type,
 		SignalCondition(InterruptCondition, "AddEvent");
 	}
 	return;
-}             // End of  AddEventToInterruptQueue
+}             // End of  AddTaggedEventToInterruptQueue
 
 /*****************************************************************
 
@@ -2065,7 +2276,7 @@ void AddEventToInterruptQueue(INT32 time_of_event, INT16 event_type,
  *****************************************************************/
 
 void GetNextOrderedEvent(INT32 *time_of_event, INT16 *event_type,
-		INT16 *event_error, INT32 *local_error)
+		INT16 *event_error, INT32 *event_tag, INT32 *local_error)
 
 {
 	EVENT *ep;
@@ -2089,6 +2300,7 @@ void GetNextOrderedEvent(INT32 *time_of_event, INT16 *event_type,
 	*time_of_event = ep->time_of_event;
 	*event_type = ep->event_type;
 	*event_error = ep->event_error;
+	*event_tag = ep->event_tag;
 	*local_error = ERR_SUCCESS;
 	rbl = ep->ring_buffer_location;
 
@@ -2265,7 +2477,10 @@ void PrintHardwareStats(void) {
     if ((double) HardwareStats.TimeWeightedNumberRunningProcesses == 0)
         MeanNumberRunningProcesses = 1.0;
 
-    aprintf( "Context Switches: %4d,  \n", HardwareStats.ContextSwitches );
+    aprintf( "Context Switches: %4d,  ", HardwareStats.ContextSwitches );
+    if (HardwareStats.Migrations > 0)
+        aprintf( "Migrations: %4d,  ", HardwareStats.Migrations );
+    aprintf( "\n" );
     // Don't mess with this line - used by auto-checker
     aprintf( "System Calls: %4d  Level Of Multiprogramming: %5.1f,  ",
         HardwareStats.NumberOfSystemCalls, 
@@ -2530,7 +2745,9 @@ void Z502CreateUserThread(void *ThreadStartAddress) {
  10. SwitchContext does a SignalCondition on this thread.
  11. That means the thread continues in THIS routine.
  12. The thread looks in its Context, finds the address where it is
- to execute, and returns that address to the caller in test.c
+ to execute, and runs the code there.
+ 13. If that context is later destroyed, the thread comes back to step 5
+ and waits for another Context.
  **************************************************************************/
 void *Z502PrepareProcessForExecution() {
     int myTid = GetMyTid();
@@ -2563,6 +2780,16 @@ void *Z502PrepareProcessForExecution() {
     CreateLock(&RequestedMutex, "Z502PrepareProcessForExecution");
     ThreadTable[ourLocalID].Mutex = RequestedMutex;
     ReleaseLock(ThreadTableLock, "Z502PrepareProcessForExecution");
+    // When our context is destroyed we come back here, and wait to be
+    // given another one.
+    if (setjmp(ThreadTable[ourLocalID].Restart) != 0) {
+        GetLock(ThreadTableLock, "Z502PrepareProcessForExecution");
+        ThreadTable[ourLocalID].Retired = FALSE;
+        ThreadTable[ourLocalID].Context = (Z502CONTEXT *) -1;
+        ThreadTable[ourLocalID].CurrentState = SUSPENDED_WAITING_FOR_CONTEXT;
+        PrintThreadTable("Restarting -> PrepareProcessForExecution\n");
+        ReleaseLock(ThreadTableLock, "Z502PrepareProcessForExecution");
+    }
     // Suspend ourselves and don't wake up until we're ready to do real work
     while (ThreadTable[ourLocalID].CurrentState == SUSPENDED_WAITING_FOR_CONTEXT) {
         //ReleaseLock( ThreadTableLock, "Z502PrepareProcessForExecution" );
@@ -2585,9 +2812,22 @@ void *Z502PrepareProcessForExecution() {
     if ( ThreadTable[ourLocalID].Context->CodeEntry != SampleCode ) {
         SetMode( "Z502PrepareProcessForExecution", USER_MODE );
     }
-    return (void *) ThreadTable[ourLocalID].Context->CodeEntry;
+    // The code is run from here rather than by our caller, so that this
+    // routine is still on the stack for a destroyed context's thread to
+    // come back to.  A process should never return; if it does, our
+    // caller is handed code that returns at once and reports the error.
+    ((void (*)(void)) ThreadTable[ourLocalID].Context->CodeEntry)();
+    return (void *) ProcessCodeReturned;
 }           // End of Z502PrepareProcessForExecution
 
+/**************************************************************************
+ ProcessCodeReturned
+ Given to the caller of Z502PrepareProcessForExecution once a process's
+ code has returned, in place of running that code a second time.
+ **************************************************************************/
+void ProcessCodeReturned(void) {
+}           // End of ProcessCodeReturned
+
 /**************************************************************************
  AssociateContextWithProcess
 
@@ -2700,7 +2940,53 @@ void SuspendProcessExecution(Z502CONTEXT *Context) {
 	//ReleaseLock( ThreadTableLock, "SuspendProcessExecution" );
 	WaitForCondition(ThreadTable[ourLocalID].Condition,
 			ThreadTable[ourLocalID].Mutex, 30, "SuspendProcessExecution2");
+	// If our context was destroyed while we slept, we never go back
+	// to the code that suspended us.
+	if (ThreadTable[ourLocalID].Retired)
+		longjmp(ThreadTable[ourLocalID].Restart, 1);
 }    //  SuspendProcessExecution
+
+/**************************************************************************
+ RetireContext
+
+ Frees the thread behind a context that will never run again.  A
+ thread that was never scheduled simply goes back to waiting for a
+ context.  Otherwise the thread is marked and woken; it then returns
+ to Z502PrepareProcessForExecution and waits there for a new context.
+ A thread that hasn't quite suspended itself yet finds the wakeup
+ waiting for it.
+ Returns FALSE if the context is unknown or belongs to the caller.
+ **************************************************************************/
+BOOL RetireContext(Z502CONTEXT *Context) {
+	int ourLocalID = -1;
+	int i;
+	Z502CONTEXT *CallersPtr = GetCurrentContext();
+
+	if (Context == CallersPtr)
+		return (FALSE);
+	GetLock(ThreadTableLock, "RetireContext");
+	for (i = 0; i < MAX_THREAD_TABLE_SIZE; i++) {
+		if (ThreadTable[i].Context == Context) {
+			ourLocalID = i;
+			break;
+		}
+	}
+	if (ourLocalID == -1) {
+		ReleaseLock(ThreadTableLock, "RetireContext");
+		return (FALSE);
+	}
+	if (ThreadTable[ourLocalID].CurrentState
+			== SUSPENDED_WAITING_FOR_FIRST_SCHED) {
+		ThreadTable[ourLocalID].Context = (Z502CONTEXT *) -1;
+		ThreadTable[ourLocalID].CurrentState = SUSPENDED_WAITING_FOR_CONTEXT;
+	} else {
+		ThreadTable[ourLocalID].Retired = TRUE;
+		SignalCondition(ThreadTable[ourLocalID].Condition, "RetireContext");
+	}
+	PrintThreadTable("RetireContext\n");
+	ReleaseLock(ThreadTableLock, "RetireContext");
+	return (TRUE);
+}                               // End of RetireContext
 /**************************************************************************
  CreateAThread
  There are Linux and Windows dependencies here.  Set up the threads
@@ -2944,6 +3230,8 @@ int GetTryLock(UINT32 RequestedMutex, char *CallingRoutine) {
 #endif
 #if defined LINUX || defined MAC
 	LockReturn = pthread_mutex_trylock( &(LocalMutex[RequestedMutex]) );
+	if ( LockReturn == 0 )
+	RecordLockAcquired( RequestedMutex, 0 );
 //    aprintf( "Code Returned in GetTRyLock is %d\n", LockReturn );
 
 	if ( LockReturn == EINVAL )
@@ -2975,6 +3263,9 @@ int GetTryLock(UINT32 RequestedMutex, char *CallingRoutine) {
 int GetLock(UINT32 RequestedMutex, char *CallingRoutine) {
 	INT32 LockReturn;
 	int ReturnValue = FALSE;
+#if defined LINUX || defined MAC
+	unsigned long long WaitStart;
+#endif
 #ifdef   WINDOWS
 	HANDLE MemoryMutex = (HANDLE) RequestedMutex;
 #endif
@@ -2996,7 +3287,15 @@ int GetLock(UINT32 RequestedMutex, char *CallingRoutine) {
 //            aprintf("GetLock:  %d %d %d\n", RequestedMutex,
 //                    (int)LocalMutex[RequestedMutex], GetMyTid() );
 //        }
-	LockReturn = pthread_mutex_lock( &(LocalMutex[RequestedMutex]) );
+	// Try first, so we only start the clock when we actually have to wait
+	WaitStart = 0;
+	LockReturn = pthread_mutex_trylock( &(LocalMutex[RequestedMutex]) );
+	if ( LockReturn == EBUSY ) {
+		WaitStart = GetLockClockNanosecs();
+		LockReturn = pthread_mutex_lock( &(LocalMutex[RequestedMutex]) );
+	}
+	if ( LockReturn == 0 )
+	RecordLockAcquired( RequestedMutex, WaitStart );
 	if ( LockReturn == EINVAL )
 	printf( "PANIC in GetLock - mutex isn't initialized\n");
 	if ( LockReturn == EFAULT )
@@ -3025,6 +3324,9 @@ int GetLock(UINT32 RequestedMutex, char *CallingRoutine) {
 int ReleaseLock(UINT32 RequestedMutex, char* CallingRoutine) {
 	int ReturnValue = FALSE;
 	int LockReturn;
+#if defined LINUX || defined MAC
+	unsigned long long HeldSince;
+#endif
 #ifdef   WINDOWS
 	HANDLE MemoryMutex = (HANDLE) RequestedMutex;
 #endif
@@ -3037,7 +3339,10 @@ int ReleaseLock(UINT32 RequestedMutex, char* CallingRoutine) {
 		ReturnValue = TRUE;
 #endif
 #if defined LINUX || defined MAC
+	HeldSince = LockStats[RequestedMutex].HeldSince;
 	LockReturn = pthread_mutex_unlock( &(LocalMutex[RequestedMutex]) );
+	if ( LockReturn == 0 )
+	RecordLockReleased( RequestedMutex, HeldSince );
 //    printf( "Return Code in Release Lock = %d\n", LockReturn );
 
 	if ( LockReturn == EINVAL )
@@ -3056,6 +3361,74 @@ int ReleaseLock(UINT32 RequestedMutex, char* CallingRoutine) {
 	return (ReturnValue);
 }            // End of ReleaseLock
 
+#if defined LINUX || defined MAC
+/**************************************************************************
+ GetLockClockNanosecs
+ Lock statistics are kept in host time, using the monotonic clock.
+ **************************************************************************/
+unsigned long long GetLockClockNanosecs() {
+	struct timespec Now;
+	clock_gettime( CLOCK_MONOTONIC, &Now );
+	return ( (unsigned long long)Now.tv_sec * 1000000000ULL + Now.tv_nsec );
+}
+
+/**************************************************************************
+ RecordLockAcquired
+ Called by the thread that has just gotten a lock.  WaitStart is when
+ it started waiting, or 0 if it got the lock without waiting.
+ **************************************************************************/
+void RecordLockAcquired(UINT32 RequestedMutex, unsigned long long WaitStart) {
+	LOCK_STATS *Stats = &(LockStats[RequestedMutex]);
+	unsigned long long Now = GetLockClockNanosecs();
+
+	Stats->Acquisitions++;
+	if ( WaitStart != 0 ) {
+		Stats->Contentions++;
+		Stats->TotalWait += Now - WaitStart;
+		if ( Now - WaitStart > Stats->MaxWait )
+			Stats->MaxWait = Now - WaitStart;
+	}
+	Stats->HeldSince = Now;
+}
+
+/**************************************************************************
+ RecordLockReleased
+ Called by the thread that has just released a lock it got at HeldSince.
+ **************************************************************************/
+void RecordLockReleased(UINT32 RequestedMutex, unsigned long long HeldSince) {
+	LOCK_STATS *Stats = &(LockStats[RequestedMutex]);
+	unsigned long long Hold = GetLockClockNanosecs() - HeldSince;
+
+	Stats->TotalHold += Hold;
+	if ( Hold > Stats->MaxHold )
+		Stats->MaxHold = Hold;
+}
+#endif
+
+/**************************************************************************
+ PrintHardwareLockStats
+ Print contention statistics for the hardware's own locks.
+ The OS calls this along with its own lock statistics.
+ **************************************************************************/
+void PrintHardwareLockStats() {
+#if defined LINUX || defined MAC
+	int i;
+	INT32 Locks[2] = { HardwareLock, EventLock };
+	char *Names[2] = { "HardwareLock", "EventLock" };
+
+	for ( i = 0; i < 2; i++ ) {
+		LOCK_STATS *Stats;
+		if ( Locks[i] < 0 )
+			continue;
+		Stats = &(LockStats[Locks[i]]);
+		aprintf( "Lock %-14s: acquired %7lu, contended %6lu, wait %8llu us (max %6llu), held %8llu us (max %6llu)\n",
+				Names[i], Stats->Acquisitions, Stats->Contentions,
+				Stats->TotalWait / 1000, Stats->MaxWait / 1000,
+				Stats->TotalHold / 1000, Stats->MaxHold / 1000 );
+	}
+#endif
+}                              // End of PrintHardwareLockStats
+
 /**************************************************************************
  GetTotalNumberOfLocks
  Return how many locks the simulation has gotten.
@@ -3647,6 +4020,13 @@ void Z502Init() {
             DiskState[i].LastSector = 0;
             DiskState[i].DiskInUse = FALSE;
             DiskState[i].EventPtr = NULL;
+            DiskState[i].NumberQueued = 0;
+            DiskState[i].NextTag = 0;
+            memset(&DiskState[i].Timing, 0, sizeof(DISK_TIMING));
+            DiskState[i].Timing.Model = DISK_TIMING_LINEAR;
+            DiskState[i].Timing.AccessTime = DISK_ACCESS_TIME;
+            DiskState[i].Timing.SeekDivisor = DISK_SEEK_DIVISOR;
+            DiskState[i].Timing.TransferTime = DISK_TRANSFER_TIME;
             HardwareStats.DiskReads[i] = 0;
             HardwareStats.DiskWrites[i] = 0;
             HardwareStats.DiskBusyTime[i] = 0;
@@ -3657,6 +4037,7 @@ void Z502Init() {
         HardwareStats.NumberChargeTimes = 0;
         HardwareStats.NumberOfFaults = 0;
         HardwareStats.NumberOfSystemCalls = 0;
+        HardwareStats.Migrations = 0;
 
         timer_state.timer_in_use = FALSE;
         timer_state.event_ptr = NULL;
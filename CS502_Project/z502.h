@@ -19,6 +19,8 @@
 
 #ifndef  Z502_H
 #define  Z502_H
+
+#include                 <setjmp.h>
 #ifdef  NT
 #define THREAD_PRIORITY_LOW           THREAD_PRIORITY_BELOW_NORMAL
 #define THREAD_PRIORITY_HIGH          THREAD_PRIORITY_TIME_CRITICAL
@@ -40,6 +42,9 @@
 #define         COST_OF_MEMORY_ACCESS           1L
 #define         COST_OF_MEMORY_MAPPED_IO        1L
 #define         COST_OF_DISK_ACCESS             8L
+#define         DISK_TRANSFER_TIME              10L   // Each extra sector in a vectored transfer
+#define         DISK_ACCESS_TIME                100L  // Every request, in the LINEAR model
+#define         DISK_SEEK_DIVISOR               20L   // Sectors of head travel per time unit, LINEAR
 #define         COST_OF_DELAY                   2L
 #define         COST_OF_CLOCK                   3L
 #define         COST_OF_TIMER                   2L
@@ -67,7 +72,8 @@
 #define         SV_ACTIVE                       (short)0
 #define         SV_VALUE                        (short)1
 #define         SV_TID                          (short)2
-#define         SV_DIMENSION                    (short)3
+#define         SV_TAG                          (short)3
+#define         SV_DIMENSION                    (short)4
 
 #define         MAX_THREAD_TABLE_SIZE            MAX_NUMBER_OF_USER_THREADS+5
 
@@ -78,6 +84,7 @@ typedef struct
     INT16               ring_buffer_location;
     INT16               event_error;
     INT16               event_type;
+    INT32               event_tag;      // Identifies the disk request
     unsigned char       structure_id;
 } EVENT;
 
@@ -103,8 +110,21 @@ typedef struct {
     INT32               NumberChargeTimes;
     INT32               NumberOfFaults;
     INT32               NumberOfSystemCalls;
+    INT32               Migrations;       // Contexts started on a new processor
 } HARDWARE_STATS;
 
+// Contention statistics kept for each hardware lock.  Times are in
+// nanoseconds of host time, since the locks are real host mutexes.
+typedef struct {
+    unsigned long       Acquisitions;
+    unsigned long       Contentions;      // Acquisitions that had to wait
+    unsigned long long  TotalWait;
+    unsigned long long  MaxWait;
+    unsigned long long  TotalHold;
+    unsigned long long  MaxHold;
+    unsigned long long  HeldSince;
+} LOCK_STATS;
+
 typedef struct {
     INT32               *queue;
     INT16               structure_id;
@@ -118,6 +138,7 @@ typedef struct {
     void                *CodeEntry;           // Location where program starts
     UINT16              *PageTablePointer;    // Address of page table for this process
     INT32               ContextStartCount;     // How many times this context has been started
+    INT16               LastProcessor;         // Processor it was last started on, or -1
  //   INT16               PC;                    // Current address of the process
  //   INT32               CallType;
     INT16               ProgramMode;          // When last run, is it KEERNEL or USER
@@ -136,6 +157,8 @@ typedef struct {
         UINT32 Condition;
         UINT32 Mutex;
         INT16 Mode;
+        BOOL Retired;             // Its context was destroyed
+        jmp_buf Restart;          // Where it waits for a new context
 } THREAD_INFO;
 
 // These are the states defined for a thread and stored in CurrentState
@@ -147,13 +170,28 @@ typedef struct {
 #define         SUSPENDED_AFTER_BEING_ACTIVE       5
 
 
+typedef struct {
+    INT32               Tag;
+    INT16               Sector;           // First sector
+    INT16               Count;            // Number of sectors
+    BOOL                IsWrite;
+    char                *Source[MAX_DISK_IO_VECTOR];
+    char                *Destination[MAX_DISK_IO_VECTOR];
+} DISK_COMMAND;
+
 typedef struct {
     EVENT               *EventPtr;
     INT16               LastSector;
     INT16               DiskInUse;
-    char                *Source;
-    char                *Destination;
+    INT16               TransferCount;    // Sectors moved when the disk interrupts
+    char                *Source[MAX_DISK_IO_VECTOR];
+    char                *Destination[MAX_DISK_IO_VECTOR];
     INT16               Action;
+    INT32               CurrentTag;       // Tag of the request being worked on
+    INT32               NextTag;
+    INT16               NumberQueued;     // Requests waiting behind the current one
+    DISK_COMMAND        Queued[DISK_QUEUE_DEPTH];
+    DISK_TIMING         Timing;           // How long requests take
 } DISK_STATE;
 
 typedef struct